@@ -0,0 +1,67 @@
+#include <AstBuilder.hpp>
+
+// std
+#include <map>
+
+using namespace std;
+using namespace triton;
+using namespace triton::ast;
+
+SharedAbstractNode RebuildNode(const SharedAstContext& Ctx, ast_e Type, const vector<SharedAbstractNode>& Children, const vector<uint512>& Integers) {
+  using BinaryMethod = SharedAbstractNode (AstContext::*)(const SharedAbstractNode&, const SharedAbstractNode&);
+  // Nodes with two bitvector (or logical) children
+  static const map<ast_e, BinaryMethod> BinaryOps = {
+    { ast_e::BVADD_NODE, &AstContext::bvadd },
+    { ast_e::BVAND_NODE, &AstContext::bvand },
+    { ast_e::BVASHR_NODE, &AstContext::bvashr },
+    { ast_e::BVLSHR_NODE, &AstContext::bvlshr },
+    { ast_e::BVMUL_NODE, &AstContext::bvmul },
+    { ast_e::BVNAND_NODE, &AstContext::bvnand },
+    { ast_e::BVNOR_NODE, &AstContext::bvnor },
+    { ast_e::BVOR_NODE, &AstContext::bvor },
+    { ast_e::BVSDIV_NODE, &AstContext::bvsdiv },
+    { ast_e::BVSGE_NODE, &AstContext::bvsge },
+    { ast_e::BVSGT_NODE, &AstContext::bvsgt },
+    { ast_e::BVSHL_NODE, &AstContext::bvshl },
+    { ast_e::BVSLE_NODE, &AstContext::bvsle },
+    { ast_e::BVSLT_NODE, &AstContext::bvslt },
+    { ast_e::BVSMOD_NODE, &AstContext::bvsmod },
+    { ast_e::BVSREM_NODE, &AstContext::bvsrem },
+    { ast_e::BVSUB_NODE, &AstContext::bvsub },
+    { ast_e::BVUDIV_NODE, &AstContext::bvudiv },
+    { ast_e::BVUGE_NODE, &AstContext::bvuge },
+    { ast_e::BVUGT_NODE, &AstContext::bvugt },
+    { ast_e::BVULE_NODE, &AstContext::bvule },
+    { ast_e::BVULT_NODE, &AstContext::bvult },
+    { ast_e::BVUREM_NODE, &AstContext::bvurem },
+    { ast_e::BVXNOR_NODE, &AstContext::bvxnor },
+    { ast_e::BVXOR_NODE, &AstContext::bvxor },
+    { ast_e::DISTINCT_NODE, &AstContext::distinct },
+    { ast_e::EQUAL_NODE, &AstContext::equal },
+    { ast_e::IFF_NODE, &AstContext::iff },
+  };
+  auto Binary = BinaryOps.find(Type);
+  if (Binary != BinaryOps.end()) {
+    return (Children.size() == 2) ? ((*Ctx).*(Binary->second))(Children[0], Children[1]) : nullptr;
+  }
+  // Fetch an integer child
+  auto Integer = [&](size_t Index) {
+    return Integers[Index].convert_to<uint32>();
+  };
+  switch (Type) {
+    case ast_e::BVNOT_NODE: return (Children.size() == 1) ? Ctx->bvnot(Children[0]) : nullptr;
+    case ast_e::BVNEG_NODE: return (Children.size() == 1) ? Ctx->bvneg(Children[0]) : nullptr;
+    case ast_e::LNOT_NODE: return (Children.size() == 1) ? Ctx->lnot(Children[0]) : nullptr;
+    case ast_e::LAND_NODE: return (Children.size() >= 2) ? Ctx->land(Children) : nullptr;
+    case ast_e::LOR_NODE: return (Children.size() >= 2) ? Ctx->lor(Children) : nullptr;
+    case ast_e::CONCAT_NODE: return (Children.size() >= 2) ? Ctx->concat(Children) : nullptr;
+    case ast_e::ITE_NODE: return (Children.size() == 3) ? Ctx->ite(Children[0], Children[1], Children[2]) : nullptr;
+    case ast_e::EXTRACT_NODE: return (Children.size() == 3 && Integers.size() == 3) ? Ctx->extract(Integer(0), Integer(1), Children[2]) : nullptr;
+    case ast_e::ZX_NODE: return (Children.size() == 2 && Integers.size() == 2) ? Ctx->zx(Integer(0), Children[1]) : nullptr;
+    case ast_e::SX_NODE: return (Children.size() == 2 && Integers.size() == 2) ? Ctx->sx(Integer(0), Children[1]) : nullptr;
+    case ast_e::BVROL_NODE: return (Children.size() == 2 && Integers.size() == 2) ? Ctx->bvrol(Children[0], Integer(1)) : nullptr;
+    case ast_e::BVROR_NODE: return (Children.size() == 2 && Integers.size() == 2) ? Ctx->bvror(Children[0], Integer(1)) : nullptr;
+    case ast_e::BV_NODE: return (Integers.size() == 2) ? Ctx->bv(Integers[0], Integer(1)) : nullptr;
+    default: return nullptr;
+  }
+}
@@ -0,0 +1,20 @@
+#ifndef ASTBUILDER_HPP
+#define ASTBUILDER_HPP
+
+// std
+#include <vector>
+
+// triton
+#include <triton/api.hpp>
+
+/*
+  Rebuild a Triton node from its type and its children, in the same layout returned by
+  getChildren(). The INTEGER_NODE children (indexes of 'extract', sizes of 'zx'/'sx',
+  rotations, value and size of 'bv') are passed by value in Integers, at the same
+  position, and may be nullptr in Children. Returns nullptr for the node types which
+  can't be rebuilt from their children (variables, references, ...).
+*/
+
+triton::ast::SharedAbstractNode RebuildNode(const triton::ast::SharedAstContext& Ctx, triton::ast::ast_e Type, const std::vector<triton::ast::SharedAbstractNode>& Children, const std::vector<triton::uint512>& Integers);
+
+#endif
@@ -0,0 +1,208 @@
+#include <AstTransfer.hpp>
+#include <AstBuilder.hpp>
+
+using namespace std;
+using namespace triton;
+using namespace triton::ast;
+using namespace triton::engines::symbolic;
+
+/*
+  Default constructor:
+  - we need the Triton context receiving the nodes
+  - the references can be kept or inlined
+*/
+
+AstTransfer::AstTransfer(API& Destination, bool KeepReferences) : Destination(Destination), KeepReferences(KeepReferences) {}
+
+/*
+  Map a variable of the source to a variable of the destination.
+*/
+
+void AstTransfer::MapVariable(usize SourceId, const SharedSymbolicVariable& Variable) {
+  this->Variables[SourceId] = { Variable, this->Destination.getAstContext()->variable(Variable) };
+}
+
+/*
+  Map an expression of the source to an expression of the destination, so the references
+  to it are kept as references to the destination one.
+*/
+
+void AstTransfer::MapExpression(const SharedSymbolicExpression& Source, const SharedSymbolicExpression& Expression) {
+  this->Expressions[Source->getId()] = { Source, Expression };
+}
+
+/*
+  Map the variables and the expressions created (or mapped) by a previous transfer back
+  to their source, so the references of the results point to the original expressions.
+*/
+
+void AstTransfer::MapInverse(const AstTransfer& Forward) {
+  for (auto& Entry : Forward.Variables) {
+    auto* Node = static_cast<VariableNode*>(Entry.second.second.get());
+    this->MapVariable(Node->getSymbolicVariable()->getId(), Entry.second.first);
+  }
+  for (auto& Entry : Forward.Expressions) {
+    this->Expressions[Entry.second.second->getId()] = { Entry.second.second, Entry.second.first };
+  }
+}
+
+/*
+  Get the IDs of the variables and the expressions of the destination, with the IDs of
+  their source, so the mapping can be rebuilt later without keeping the source objects.
+*/
+
+unordered_map<usize, usize> AstTransfer::GetVariableIds() const {
+  unordered_map<usize, usize> Ids;
+  for (auto& Entry : this->Variables) {
+    Ids[static_cast<VariableNode*>(Entry.second.second.get())->getSymbolicVariable()->getId()] = Entry.first;
+  }
+  return Ids;
+}
+
+unordered_map<usize, usize> AstTransfer::GetExpressionIds() const {
+  unordered_map<usize, usize> Ids;
+  for (auto& Entry : this->Expressions) {
+    Ids[Entry.second.second->getId()] = Entry.first;
+  }
+  return Ids;
+}
+
+/*
+  Get the destination node of a variable of the source, creating a new variable with
+  the same size (and alias) the first time it's seen.
+*/
+
+SharedAbstractNode AstTransfer::GetVariable(const SharedSymbolicVariable& Variable) {
+  auto Known = this->Variables.find(Variable->getId());
+  if (Known == this->Variables.end()) {
+    auto Created = this->Destination.newSymbolicVariable(Variable->getSize(), Variable->getAlias());
+    Known = this->Variables.emplace(Variable->getId(), make_pair(Variable, this->Destination.getAstContext()->variable(Created))).first;
+  }
+  return Known->second.second;
+}
+
+/*
+  Transfer an AST visiting it in post-order with an explicit stack: a node is rebuilt
+  when all its children are, and each node is rebuilt only once.
+*/
+
+SharedAbstractNode AstTransfer::Transfer(const SharedAbstractNode& Root) {
+  auto Ctx = this->Destination.getAstContext();
+  // Nodes to be rebuilt, with the flag of their children being already pushed
+  vector<pair<SharedAbstractNode, bool>> Stack = { { Root, false } };
+  vector<SharedAbstractNode> Children;
+  vector<uint512> Integers;
+  try {
+    while (!Stack.empty()) {
+      auto Node = Stack.back().first;
+      bool Expanded = Stack.back().second;
+      // Already transferred
+      if (this->Transferred.find(Node) != this->Transferred.end()) {
+        Stack.pop_back();
+        continue;
+      }
+      SharedAbstractNode Built = nullptr;
+      switch (Node->getType()) {
+        case ast_e::BV_NODE: {
+          Built = Ctx->bv(Node->evaluate(), Node->getBitvectorSize());
+        } break;
+        case ast_e::VARIABLE_NODE: {
+          Built = this->GetVariable(static_cast<VariableNode*>(Node.get())->getSymbolicVariable());
+        } break;
+        case ast_e::REFERENCE_NODE: {
+          const auto& Expression = static_cast<ReferenceNode*>(Node.get())->getSymbolicExpression();
+          // Reuse the expression already copied
+          auto Copied = this->Expressions.find(Expression->getId());
+          if (Copied != this->Expressions.end() && this->KeepReferences) {
+            Built = Ctx->reference(Copied->second.second);
+            break;
+          }
+          // Transfer the referenced AST first
+          auto Referenced = this->Transferred.find(Expression->getAst());
+          if (Referenced == this->Transferred.end()) {
+            if (Expanded) {
+              this->Error = "reference " + to_string(Expression->getId()) + " not transferred";
+              return nullptr;
+            }
+            Stack.back().second = true;
+            Stack.push_back({ Expression->getAst(), false });
+            continue;
+          }
+          if (this->KeepReferences) {
+            auto Copy = this->Destination.newSymbolicExpression(Referenced->second, Expression->getComment());
+            this->Expressions[Expression->getId()] = { Expression, Copy };
+            Built = Ctx->reference(Copy);
+          } else {
+            Built = Referenced->second;
+          }
+        } break;
+        default: {
+          // Push the children first (the integers are read by value)
+          if (!Expanded) {
+            Stack.back().second = true;
+            for (auto& Child : Node->getChildren()) {
+              if (Child->getType() != ast_e::INTEGER_NODE && this->Transferred.find(Child) == this->Transferred.end()) {
+                Stack.push_back({ Child, false });
+              }
+            }
+            continue;
+          }
+          // Rebuild the node from the transferred children
+          Children.clear();
+          Integers.clear();
+          for (auto& Child : Node->getChildren()) {
+            bool IsInteger = (Child->getType() == ast_e::INTEGER_NODE);
+            Children.push_back(IsInteger ? nullptr : this->Transferred[Child]);
+            Integers.push_back(IsInteger ? static_cast<IntegerNode*>(Child.get())->getInteger() : 0);
+          }
+          Built = RebuildNode(Ctx, Node->getType(), Children, Integers);
+          if (Built == nullptr) {
+            this->Error = "unsupported node type " + to_string(Node->getType());
+            return nullptr;
+          }
+        } break;
+      }
+      this->Transferred[Node] = Built;
+      Stack.pop_back();
+    }
+  } catch (const exception& E) {
+    this->Error = E.what();
+    return nullptr;
+  }
+  return this->Transferred[Root];
+}
+
+/*
+  Transfer a batch of ASTs, sharing the nodes transferred for the previous ones.
+*/
+
+vector<SharedAbstractNode> AstTransfer::Transfer(const vector<SharedAbstractNode>& Roots) {
+  vector<SharedAbstractNode> Result;
+  Result.reserve(Roots.size());
+  for (auto& Root : Roots) {
+    auto Node = this->Transfer(Root);
+    if (Node == nullptr) {
+      return {};
+    }
+    Result.push_back(Node);
+  }
+  return Result;
+}
+
+/*
+  Forget the transferred nodes and expressions, releasing the source nodes (the mapped
+  expressions are forgotten too, the variables stay mapped).
+*/
+
+void AstTransfer::Reset() {
+  this->Transferred.clear();
+  this->Expressions.clear();
+}
+
+/*
+  Get the last error.
+*/
+
+const string& AstTransfer::GetError() const {
+  return this->Error;
+}
@@ -0,0 +1,78 @@
+#ifndef ASTTRANSFER_HPP
+#define ASTTRANSFER_HPP
+
+// std
+#include <unordered_map>
+#include <utility>
+#include <string>
+#include <vector>
+
+// triton
+#include <triton/api.hpp>
+
+/*
+  Transfer of Triton ASTs into the AstContext of another API, e.g. from the tracer to
+  the API owned by a worker thread and back. Each node is rebuilt once, after its
+  children, so the shared sub-trees stay shared and the cost is linear in the size of
+  the DAG. The variables are remapped by ID: to the variables mapped by the caller, or
+  to new variables of the destination. The references become references to expressions
+  of the destination (created once for each expression), or are inlined if requested.
+  The transferred nodes are remembered until Reset, so a batch of ASTs sharing their
+  sub-trees only pays for them once. The source nodes are only read.
+*/
+
+class AstTransfer {
+private:
+
+  // Triton context receiving the nodes
+  triton::API& Destination;
+
+  // Keep the references (instead of inlining the referenced ASTs)
+  bool KeepReferences;
+
+  // Variables of the source by ID, with their node in the destination
+  std::unordered_map<triton::usize, std::pair<triton::engines::symbolic::SharedSymbolicVariable, triton::ast::SharedAbstractNode>> Variables;
+
+  // Expressions of the source by ID, with their copy in the destination
+  std::unordered_map<triton::usize, std::pair<triton::engines::symbolic::SharedSymbolicExpression, triton::engines::symbolic::SharedSymbolicExpression>> Expressions;
+
+  // Transferred nodes (the source nodes are kept alive, so they can't be reused)
+  std::unordered_map<triton::ast::SharedAbstractNode, triton::ast::SharedAbstractNode> Transferred;
+
+  // Last error
+  std::string Error;
+
+  // Get the destination node of a variable of the source
+  triton::ast::SharedAbstractNode GetVariable(const triton::engines::symbolic::SharedSymbolicVariable& Variable);
+
+public:
+  // Default constructor
+  AstTransfer(triton::API& Destination, bool KeepReferences = true);
+
+  // Map a variable of the source (by ID) to a variable of the destination
+  void MapVariable(triton::usize SourceId, const triton::engines::symbolic::SharedSymbolicVariable& Variable);
+
+  // Map an expression of the source to an expression of the destination
+  void MapExpression(const triton::engines::symbolic::SharedSymbolicExpression& Source, const triton::engines::symbolic::SharedSymbolicExpression& Expression);
+
+  // Map the variables and the expressions back, to transfer the results of a previous transfer to its source
+  void MapInverse(const AstTransfer& Forward);
+
+  // Get the IDs of the variables and the expressions created (or mapped) in the destination, with their source IDs
+  std::unordered_map<triton::usize, triton::usize> GetVariableIds() const;
+  std::unordered_map<triton::usize, triton::usize> GetExpressionIds() const;
+
+  // Transfer an AST (nullptr on error, see GetError)
+  triton::ast::SharedAbstractNode Transfer(const triton::ast::SharedAbstractNode& Root);
+
+  // Transfer a batch of ASTs sharing their nodes (empty on error, see GetError)
+  std::vector<triton::ast::SharedAbstractNode> Transfer(const std::vector<triton::ast::SharedAbstractNode>& Roots);
+
+  // Forget the transferred nodes and expressions (the variables stay mapped)
+  void Reset();
+
+  // Get the last error
+  const std::string& GetError() const;
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include <AsyncTranslator.hpp>
+
+/*
+  Default constructor:
+  - we need the Triton context of the submitted ASTs
+  - the options configure the queue, the workers and the limits of each translation
+*/
+
+AsyncTranslator::AsyncTranslator(API& Api, const AsyncTranslatorOptions& Options) : Api(Api), Options(Options), Jobs(Options.QueueCapacity), Stopping(false), Collected(0), Submitted(0), Rejected(0), Completed(0) {
+  // Start the workers
+  for (unsigned i = 0; i < std::max(1u, this->Options.Threads); i++) {
+    this->Workers.emplace_back(&AsyncTranslator::Work, this);
+  }
+}
+
+/*
+  Default destructor: wait for the queued translations.
+*/
+
+AsyncTranslator::~AsyncTranslator() {
+  this->Stop();
+}
+
+/*
+  Stop the workers. The queued translations are finished, or cancelled if requested
+  (their results are delivered anyway).
+*/
+
+void AsyncTranslator::Stop(bool CancelQueued) {
+  if (CancelQueued) {
+    this->Stopping = true;
+  }
+  this->Jobs.Close();
+  for (auto& Worker : this->Workers) {
+    if (Worker.joinable()) {
+      Worker.join();
+    }
+  }
+}
+
+/*
+  Translate the queued ASTs until the queue is closed. Each job owns its Triton context,
+  so the translation gets a pool of contexts bound to it; the worker never touches the
+  caller's context (the submitted AST is only handed back in the result).
+*/
+
+void AsyncTranslator::Work() {
+  AsyncJob Job;
+  while (this->Jobs.Pop(Job)) {
+    AsyncResult Result;
+    Result.Node = Job.Node;
+    Result.Api = Job.Api;
+    Result.VariableIds = std::move(Job.VariableIds);
+    Result.ExpressionIds = std::move(Job.ExpressionIds);
+    if (this->Stopping || Job.Cancelled->load()) {
+      // Cancelled while queued
+      Result.Status = TranslationStatus::Cancelled;
+    } else {
+      // Translate within the limits (the cancellation is checked with them)
+      TranslationLimits Limits;
+      if (this->Options.Timeout) {
+        Limits.Deadline = chrono::steady_clock::now() + chrono::milliseconds(this->Options.Timeout);
+      }
+      Limits.MaxNodes = this->Options.MaxNodes;
+      Limits.MaxInstructions = this->Options.MaxInstructions;
+      Limits.Cancelled = Job.Cancelled.get();
+      ContextPool Pool(*Job.Api, this->Options.Pool);
+      Pool.SetLimits(Limits);
+      try {
+        auto Module = Pool.TritonAstToLLVMIR(Job.Transferred, this->Options.MaxDepth);
+        Result.Status = Pool.GetTranslator().GetStatus();
+        if (Module == nullptr && Result.Status == TranslationStatus::Success) {
+          Result.Status = TranslationStatus::Failed;
+        }
+        // Hand over the Module as bitcode, it can't leave the worker's context
+        if (Module != nullptr) {
+          Result.Bitcode = SerializeModule(*Module);
+          Result.FakeVariables = Pool.GetTranslator().GetFakeVariables();
+        }
+      } catch (const exception& E) {
+        cout << "AsyncTranslator: " << E.what() << endl;
+        Result.Status = TranslationStatus::Failed;
+      }
+    }
+    // Drop the nodes of the job's context before handing it over with the result
+    Job.Transferred = nullptr;
+    Job.Api = nullptr;
+    this->Completed++;
+    // Deliver the result
+    if (Job.OnDone) {
+      try {
+        Job.OnDone(Result);
+      } catch (const exception& E) {
+        cout << "AsyncTranslator: " << E.what() << endl;
+      }
+    }
+    Job.Result.set_value(std::move(Result));
+    // The caller's thread can drop the submitted AST now
+    auto Released = Job.Released;
+    Job = AsyncJob();
+    Released->store(true);
+  }
+}
+
+/*
+  Prepare the job and the ticket of a submission, on the caller's thread: the AST is
+  transferred into a Triton context owned by the job, and only the IDs of the mapping
+  are kept, so nothing of the caller's context reaches the worker.
+*/
+
+AsyncJob AsyncTranslator::Prepare(const SharedAbstractNode& Node, const AsyncCallback& OnDone, AsyncTicket& Ticket) {
+  AsyncJob Job;
+  Job.Node = Node;
+  Job.Cancelled = make_shared<atomic<bool>>(false);
+  Job.Released = make_shared<atomic<bool>>(false);
+  Job.OnDone = OnDone;
+  Ticket.Result = Job.Result.get_future();
+  Ticket.Cancelled = Job.Cancelled;
+  // Transfer the AST into the job's context
+  Job.Api = make_shared<API>();
+  Job.Api->setArchitecture(this->Api.getArchitecture());
+  AstTransfer Forward(*Job.Api);
+  Job.Transferred = Forward.Transfer(Node);
+  if (Job.Transferred == nullptr) {
+    cout << "AsyncTranslator: " << Forward.GetError() << endl;
+    Job.Api = nullptr;
+    return Job;
+  }
+  Job.VariableIds = Forward.GetVariableIds();
+  Job.ExpressionIds = Forward.GetExpressionIds();
+  return Job;
+}
+
+/*
+  Keep a submitted AST alive until its job is released: its nodes belong to the caller's
+  context, so the last reference must be dropped on the caller's thread.
+*/
+
+void AsyncTranslator::Retain(const SharedAbstractNode& Node, const shared_ptr<atomic<bool>>& Released) {
+  auto Done = [](const pair<SharedAbstractNode, shared_ptr<atomic<bool>>>& Entry) {
+    return Entry.second->load();
+  };
+  this->Retained.erase(remove_if(this->Retained.begin(), this->Retained.end(), Done), this->Retained.end());
+  if (Node != nullptr) {
+    this->Retained.push_back({ Node, Released });
+  }
+}
+
+/*
+  Queue an AST, waiting while the queue is full so the producer slows down to the pace
+  of the workers. Once stopped, the ticket is cancelled right away.
+*/
+
+AsyncTicket AsyncTranslator::Submit(const SharedAbstractNode& Node, const AsyncCallback& OnDone) {
+  AsyncTicket Ticket;
+  auto Job = this->Prepare(Node, OnDone, Ticket);
+  auto Cancelled = Job.Cancelled;
+  auto Released = Job.Released;
+  if (Job.Api == nullptr) {
+    // The AST can't be transferred: deliver a failed result
+    this->Rejected++;
+    AsyncResult Outcome;
+    Outcome.Node = Node;
+    Outcome.Status = TranslationStatus::Unsupported;
+    Job.Result.set_value(std::move(Outcome));
+    return Ticket;
+  }
+  if (this->Jobs.Push(std::move(Job))) {
+    this->Submitted++;
+    this->Retain(Node, Released);
+  } else {
+    // The queue is closed, the job is gone: deliver a cancelled result
+    this->Rejected++;
+    promise<AsyncResult> Result;
+    Ticket.Result = Result.get_future();
+    Cancelled->store(true);
+    AsyncResult Outcome;
+    Outcome.Node = Node;
+    Outcome.Status = TranslationStatus::Cancelled;
+    Result.set_value(std::move(Outcome));
+  }
+  return Ticket;
+}
+
+/*
+  Queue an AST only if there's a free slot, so the producer can drop the work when the
+  workers can't keep up.
+*/
+
+bool AsyncTranslator::TrySubmit(const SharedAbstractNode& Node, AsyncTicket& Ticket, const AsyncCallback& OnDone) {
+  // Don't pay for the transfer when the work would be dropped anyway
+  if (this->Jobs.Size() >= this->Options.QueueCapacity) {
+    this->Rejected++;
+    return false;
+  }
+  AsyncTicket Queued;
+  auto Job = this->Prepare(Node, OnDone, Queued);
+  auto Released = Job.Released;
+  if (Job.Api == nullptr || !this->Jobs.TryPush(std::move(Job))) {
+    this->Rejected++;
+    return false;
+  }
+  this->Submitted++;
+  this->Retain(Node, Released);
+  Ticket = std::move(Queued);
+  return true;
+}
+
+/*
+  Lift a result back to a Triton AST. The Module is lifted in the job's context (its
+  variables and references have the IDs of that context), then the AST is transferred to
+  the caller's context mapping the variables and the expressions back; this creates
+  Triton nodes, so it must run on the thread owning the Triton context. The LLVM context
+  of the Modules is renewed as often as the ones of the workers.
+*/
+
+SharedAbstractNode AsyncTranslator::Collect(const AsyncResult& Result) {
+  this->Retain(nullptr, nullptr);
+  if (Result.Status != TranslationStatus::Success || Result.Bitcode.empty() || Result.Api == nullptr) {
+    return Result.Node;
+  }
+  // Renew the context once it did enough work
+  auto MaxTranslations = this->Options.Pool.MaxTranslations;
+  if (this->Context == nullptr || (MaxTranslations && this->Collected >= MaxTranslations)) {
+    this->Context = make_unique<LLVMContext>();
+    this->Collected = 0;
+  }
+  this->Collected++;
+  auto Module = DeserializeModule(Result.Bitcode, *this->Context);
+  if (Module == nullptr) {
+    return Result.Node;
+  }
+  // Collect the variables of the job's context and restore the sub-trees cut at the maximum depth
+  auto& JobApi = *Result.Api;
+  auto JobCtx = JobApi.getAstContext();
+  map<string, SharedAbstractNode> Variables;
+  for (auto& Entry : JobApi.getSymbolicVariables()) {
+    Variables[Entry.second->getName()] = JobCtx->variable(Entry.second);
+  }
+  for (auto& FakeVar : Result.FakeVariables) {
+    Variables[FakeVar.first] = FakeVar.second;
+  }
+  // Translate back to a Triton AST (of the same kind) in the job's context
+  Translator Collector(*this->Context, JobApi, this->Options.Pool.Translation);
+  auto Lifted = Collector.LLVMIRToTritonAst(Module, Variables, false, Result.Node->isLogical());
+  if (Lifted == nullptr) {
+    return Result.Node;
+  }
+  // Transfer it to the caller's context
+  AstTransfer Backward(this->Api);
+  for (auto& Ids : Result.VariableIds) {
+    Backward.MapVariable(Ids.first, this->Api.getSymbolicVariable(Ids.second));
+  }
+  for (auto& Ids : Result.ExpressionIds) {
+    Backward.MapExpression(JobApi.getSymbolicExpression(Ids.first), this->Api.getSymbolicExpression(Ids.second));
+  }
+  auto Simplified = Backward.Transfer(Lifted);
+  if (Simplified == nullptr) {
+    cout << "AsyncTranslator: " << Backward.GetError() << endl;
+    return Result.Node;
+  }
+  return Simplified;
+}
+
+/*
+  Getters.
+*/
+
+size_t AsyncTranslator::GetQueued() {
+  return this->Jobs.Size();
+}
+
+uint64_t AsyncTranslator::GetSubmitted() const {
+  return this->Submitted;
+}
+
+uint64_t AsyncTranslator::GetRejected() const {
+  return this->Rejected;
+}
+
+uint64_t AsyncTranslator::GetCompleted() const {
+  return this->Completed;
+}
@@ -0,0 +1,154 @@
+#ifndef ASYNCTRANSLATOR_HPP
+#define ASYNCTRANSLATOR_HPP
+
+// std
+#include <functional>
+#include <future>
+
+// translator
+#include <ContextPool.hpp>
+#include <BoundedQueue.hpp>
+#include <AstTransfer.hpp>
+
+// strutures
+typedef struct AsyncTranslatorOptions {
+  // Number of worker threads
+  unsigned Threads = 1;
+  // Maximum number of queued translations (Submit waits and TrySubmit fails when full)
+  size_t QueueCapacity = 256;
+  // Maximum depth of the lifted ASTs
+  ssize_t MaxDepth = -1;
+  // Limits of each translation (0 = unlimited)
+  uint64_t Timeout = 0;
+  uint64_t MaxNodes = 0;
+  uint64_t MaxInstructions = 0;
+  // Options of the workers' context(s)
+  ContextPoolOptions Pool;
+} AsyncTranslatorOptions;
+
+typedef struct AsyncResult {
+  // Submitted AST
+  SharedAbstractNode Node;
+  // Triton context owned by the translation
+  shared_ptr<API> Api;
+  // Variables and expressions of Api by ID, with the ID in the caller's context
+  unordered_map<usize, usize> VariableIds;
+  unordered_map<usize, usize> ExpressionIds;
+  // Outcome of the translation
+  TranslationStatus Status = TranslationStatus::Failed;
+  // Bitcode of the optimized Module (empty unless successful)
+  string Bitcode;
+  // Sub-trees cut at the maximum depth (by fake variable name, nodes of Api)
+  map<string, SharedAbstractNode> FakeVariables;
+} AsyncResult;
+
+// Callback receiving a result (on the worker thread, before the future is ready; it must not keep Node, a node of the caller's context)
+using AsyncCallback = function<void(const AsyncResult& Result)>;
+
+typedef struct AsyncTicket {
+  // Result of the translation (ready once done, cancelled or failed)
+  future<AsyncResult> Result;
+  // Flag cancelling the translation, queued or running
+  shared_ptr<atomic<bool>> Cancelled;
+  // Cancel the translation (the result is still delivered, with the Cancelled status)
+  void Cancel() {
+    if (this->Cancelled) {
+      this->Cancelled->store(true);
+    }
+  }
+} AsyncTicket;
+
+typedef struct AsyncJob {
+  SharedAbstractNode Node;
+  shared_ptr<API> Api;
+  SharedAbstractNode Transferred;
+  unordered_map<usize, usize> VariableIds;
+  unordered_map<usize, usize> ExpressionIds;
+  promise<AsyncResult> Result;
+  shared_ptr<atomic<bool>> Cancelled;
+  shared_ptr<atomic<bool>> Released;
+  AsyncCallback OnDone;
+} AsyncJob;
+
+/*
+  Asynchronous front end of the translation, so a tracer producing expressions doesn't
+  stall on each one: the ASTs are queued and lifted to optimized LLVM-IR by worker
+  threads. The queue is bounded: Submit waits for a free slot (backpressure), TrySubmit
+  lets the caller drop the work instead. The Triton context of the caller keeps changing
+  while the tracer runs, so the workers never touch it: Submit transfers the AST into a
+  Triton context owned by the job, the worker translates it there and delivers the
+  result as bitcode, and Collect lifts it back in the job's context and transfers it to
+  the caller's one (with the inverse mapping), on the caller's thread.
+*/
+
+class AsyncTranslator {
+private:
+
+  // Triton context of the submitted ASTs
+  API& Api;
+
+  // Options of the translations
+  AsyncTranslatorOptions Options;
+
+  // Queued translations and their workers
+  BoundedQueue<AsyncJob> Jobs;
+  vector<thread> Workers;
+
+  // Submitted ASTs kept alive by the caller's thread until their job is released (their
+  // nodes belong to the caller's context, so the workers must not destroy them)
+  vector<pair<SharedAbstractNode, shared_ptr<atomic<bool>>>> Retained;
+
+  // Set to cancel the queued translations while stopping
+  atomic<bool> Stopping;
+
+  // Context lifting the results back (caller's thread, renewed periodically)
+  unique_ptr<LLVMContext> Context;
+  uint64_t Collected;
+
+  // Outcome of the submissions
+  atomic<uint64_t> Submitted;
+  atomic<uint64_t> Rejected;
+  atomic<uint64_t> Completed;
+
+  // Translate the queued ASTs until the queue is closed
+  void Work();
+
+  // Prepare the job and the ticket of a submission (nullptr Api if the AST can't be transferred)
+  AsyncJob Prepare(const SharedAbstractNode& Node, const AsyncCallback& OnDone, AsyncTicket& Ticket);
+
+  // Keep a submitted AST alive until its job is released, dropping the released ones
+  void Retain(const SharedAbstractNode& Node, const shared_ptr<atomic<bool>>& Released);
+
+public:
+  // Default constructor (starts the workers)
+  AsyncTranslator(API& Api, const AsyncTranslatorOptions& Options = AsyncTranslatorOptions());
+
+  // Default destructor (waits for the queued translations)
+  ~AsyncTranslator();
+
+  // The workers are bound to this object
+  AsyncTranslator(const AsyncTranslator&) = delete;
+  AsyncTranslator& operator=(const AsyncTranslator&) = delete;
+
+  // Queue an AST, waiting while the queue is full
+  AsyncTicket Submit(const SharedAbstractNode& Node, const AsyncCallback& OnDone = nullptr);
+
+  // Queue an AST only if the queue isn't full (false if the work has to be dropped)
+  bool TrySubmit(const SharedAbstractNode& Node, AsyncTicket& Ticket, const AsyncCallback& OnDone = nullptr);
+
+  // Lift a result back to a Triton AST, on the caller's thread (the submitted AST unless successful)
+  SharedAbstractNode Collect(const AsyncResult& Result);
+
+  // Stop the workers, finishing or cancelling the queued translations
+  void Stop(bool CancelQueued = false);
+
+  // Get the number of queued translations
+  size_t GetQueued();
+
+  // Get the outcome of the submissions
+  uint64_t GetSubmitted() const;
+  uint64_t GetRejected() const;
+  uint64_t GetCompleted() const;
+};
+
+#endif
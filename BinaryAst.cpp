@@ -0,0 +1,372 @@
+#include <BinaryAst.hpp>
+#include <AstBuilder.hpp>
+
+// std
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+// posix
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace triton;
+using namespace triton::ast;
+
+/*
+  Add a constant to the pool (each value is stored only once).
+*/
+
+uint32_t BinaryAstWriter::AddConstant(const uint512& Value) {
+  auto Known = this->ConstantIds.find(Value);
+  if (Known != this->ConstantIds.end()) {
+    return Known->second;
+  }
+  BinaryAst::ConstantRecord Record = { (uint32_t)this->Limbs.size(), 0 };
+  for (uint512 Rest = Value; Rest != 0; Rest >>= 64) {
+    this->Limbs.push_back((Rest & 0xFFFFFFFFFFFFFFFFULL).convert_to<uint64_t>());
+    Record.Limbs++;
+  }
+  this->Constants.push_back(Record);
+  return this->ConstantIds[Value] = this->Constants.size() - 1;
+}
+
+/*
+  Add a variable to the table (each name is stored only once).
+*/
+
+uint32_t BinaryAstWriter::AddVariable(const string& Name, uint32_t Size) {
+  auto Known = this->VariableIds.find(Name);
+  if (Known != this->VariableIds.end()) {
+    return Known->second;
+  }
+  BinaryAst::VariableRecord Record = { Size, (uint32_t)this->Strings.size(), (uint32_t)Name.size(), 0 };
+  this->Strings += Name;
+  this->Variables.push_back(Record);
+  return this->VariableIds[Name] = this->Variables.size() - 1;
+}
+
+/*
+  Add a root, visiting its nodes in post-order without recursion.
+*/
+
+uint32_t BinaryAstWriter::Add(const SharedAbstractNode& Root) {
+  vector<pair<SharedAbstractNode, bool>> Stack = { { Root, false } };
+  while (!Stack.empty()) {
+    auto Node = Stack.back().first;
+    auto Expanded = Stack.back().second;
+    // Skip the already written nodes
+    if (this->NodeIds.find(Node) != this->NodeIds.end()) {
+      Stack.pop_back();
+      continue;
+    }
+    // Write the references as the AST they point to
+    if (Node->getType() == ast_e::REFERENCE_NODE) {
+      auto& Ast = static_cast<ReferenceNode*>(Node.get())->getSymbolicExpression()->getAst();
+      auto Known = this->NodeIds.find(Ast);
+      if (Known != this->NodeIds.end()) {
+        this->NodeIds[Node] = Known->second;
+        Stack.pop_back();
+      } else {
+        Stack.push_back({ Ast, false });
+      }
+      continue;
+    }
+    BinaryAst::NodeRecord Record = { (uint32_t)Node->getType(), Node->getBitvectorSize(), 0, 0 };
+    if (!Node->isSymbolized() && !Node->isLogical() && Node->getType() != ast_e::INTEGER_NODE) {
+      // Fold the constant sub-trees
+      Record.Type = ast_e::BV_NODE;
+      Record.First = this->AddConstant(Node->evaluate());
+    } else if (Node->getType() == ast_e::INTEGER_NODE) {
+      Record.First = this->AddConstant(static_cast<IntegerNode*>(Node.get())->getInteger());
+    } else if (Node->getType() == ast_e::VARIABLE_NODE) {
+      auto& SymVar = static_cast<VariableNode*>(Node.get())->getSymbolicVariable();
+      Record.First = this->AddVariable(SymVar->getAlias().empty() ? SymVar->getName() : SymVar->getAlias(), SymVar->getSize());
+    } else {
+      auto& NodeChildren = Node->getChildren();
+      // Write the children first
+      if (!Expanded) {
+        Stack.back().second = true;
+        for (auto Child = NodeChildren.rbegin(); Child != NodeChildren.rend(); Child++) {
+          if (this->NodeIds.find(*Child) == this->NodeIds.end()) {
+            Stack.push_back({ *Child, false });
+          }
+        }
+        continue;
+      }
+      Record.First = this->Children.size();
+      Record.Count = NodeChildren.size();
+      for (auto& Child : NodeChildren) {
+        this->Children.push_back(this->NodeIds[Child]);
+      }
+    }
+    this->NodeIds[Node] = this->Nodes.size();
+    this->Nodes.push_back(Record);
+    Stack.pop_back();
+  }
+  this->Roots.push_back(this->NodeIds[Root]);
+  return this->Roots.size() - 1;
+}
+
+/*
+  Write the header and the sections, padding each of them to 8 bytes.
+*/
+
+bool BinaryAstWriter::Write(ostream& Output) const {
+  BinaryAst::Header Header;
+  memcpy(Header.Magic, BinaryAst::Magic, sizeof(Header.Magic));
+  Header.Version = BinaryAst::Version;
+  Header.NodeCount = this->Nodes.size();
+  Header.ChildCount = this->Children.size();
+  Header.ConstantCount = this->Constants.size();
+  Header.LimbCount = this->Limbs.size();
+  Header.VariableCount = this->Variables.size();
+  Header.RootCount = this->Roots.size();
+  Header.StringBytes = this->Strings.size();
+  auto Section = [&](const void* Data, size_t Bytes) {
+    static const char Padding[8] = {};
+    Output.write((const char*)Data, Bytes);
+    Output.write(Padding, (8 - Bytes % 8) % 8);
+  };
+  Section(&Header, sizeof(Header));
+  Section(this->Nodes.data(), this->Nodes.size() * sizeof(BinaryAst::NodeRecord));
+  Section(this->Children.data(), this->Children.size() * sizeof(uint32_t));
+  Section(this->Constants.data(), this->Constants.size() * sizeof(BinaryAst::ConstantRecord));
+  Section(this->Limbs.data(), this->Limbs.size() * sizeof(uint64_t));
+  Section(this->Variables.data(), this->Variables.size() * sizeof(BinaryAst::VariableRecord));
+  Section(this->Roots.data(), this->Roots.size() * sizeof(uint32_t));
+  Section(this->Strings.data(), this->Strings.size());
+  return (bool)Output;
+}
+
+bool BinaryAstWriter::Write(const string& Path) const {
+  ofstream Output(Path, ios::binary);
+  if (!Output) {
+    cout << "BinaryAstWriter: can't open " << Path << endl;
+    return false;
+  }
+  return this->Write(Output);
+}
+
+/*
+  Default constructor and destructor.
+*/
+
+BinaryAstReader::BinaryAstReader() : Data(nullptr), Length(0), Header(nullptr), Nodes(nullptr), Children(nullptr), Constants(nullptr), Limbs(nullptr), Variables(nullptr), Roots(nullptr), Strings(nullptr) {}
+
+BinaryAstReader::~BinaryAstReader() {
+  this->Close();
+}
+
+/*
+  Map a file in memory and locate its sections.
+*/
+
+bool BinaryAstReader::Open(const string& Path) {
+  this->Close();
+  int File = open(Path.c_str(), O_RDONLY);
+  if (File < 0) {
+    this->Error = "can't open " + Path;
+    return false;
+  }
+  struct stat Stat;
+  if (fstat(File, &Stat) != 0 || Stat.st_size == 0) {
+    this->Error = "can't map " + Path;
+    close(File);
+    return false;
+  }
+  auto* Mapping = mmap(nullptr, Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+  close(File);
+  if (Mapping == MAP_FAILED) {
+    this->Error = "can't map " + Path;
+    return false;
+  }
+  this->Data = (const uint8_t*)Mapping;
+  this->Length = Stat.st_size;
+  if (!this->Validate()) {
+    this->Close();
+    return false;
+  }
+  return true;
+}
+
+void BinaryAstReader::Close() {
+  if (this->Data) {
+    munmap((void*)this->Data, this->Length);
+  }
+  this->Data = nullptr;
+  this->Length = 0;
+  this->Header = nullptr;
+}
+
+/*
+  Check the header, the bounds of the sections and the pools (the nodes are checked
+  while they are rebuilt).
+*/
+
+bool BinaryAstReader::Validate() {
+  if (this->Length < sizeof(BinaryAst::Header)) {
+    this->Error = "truncated header";
+    return false;
+  }
+  this->Header = (const BinaryAst::Header*)this->Data;
+  if (memcmp(this->Header->Magic, BinaryAst::Magic, sizeof(BinaryAst::Magic)) != 0 || this->Header->Version != BinaryAst::Version) {
+    this->Error = "unsupported file format";
+    return false;
+  }
+  // Locate the sections
+  size_t Offset = sizeof(BinaryAst::Header);
+  auto Section = [&](uint64_t Count, size_t RecordSize) -> const uint8_t* {
+    if (Offset > this->Length || Count > (this->Length - Offset) / RecordSize) {
+      return nullptr;
+    }
+    auto* Start = this->Data + Offset;
+    Offset += (Count * RecordSize + 7) & ~7ULL;
+    return Start;
+  };
+  this->Nodes = (const BinaryAst::NodeRecord*)Section(this->Header->NodeCount, sizeof(BinaryAst::NodeRecord));
+  this->Children = (const uint32_t*)Section(this->Header->ChildCount, sizeof(uint32_t));
+  this->Constants = (const BinaryAst::ConstantRecord*)Section(this->Header->ConstantCount, sizeof(BinaryAst::ConstantRecord));
+  this->Limbs = (const uint64_t*)Section(this->Header->LimbCount, sizeof(uint64_t));
+  this->Variables = (const BinaryAst::VariableRecord*)Section(this->Header->VariableCount, sizeof(BinaryAst::VariableRecord));
+  this->Roots = (const uint32_t*)Section(this->Header->RootCount, sizeof(uint32_t));
+  this->Strings = (const char*)Section(this->Header->StringBytes, 1);
+  if (!this->Nodes || !this->Children || !this->Constants || !this->Limbs || !this->Variables || !this->Roots || !this->Strings) {
+    this->Error = "truncated file";
+    return false;
+  }
+  // Check the pools
+  for (uint64_t i = 0; i < this->Header->ConstantCount; i++) {
+    auto& Constant = this->Constants[i];
+    if (Constant.Limbs > 8 || (uint64_t)Constant.Offset + Constant.Limbs > this->Header->LimbCount) {
+      this->Error = "invalid constant " + to_string(i);
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < this->Header->VariableCount; i++) {
+    auto& Variable = this->Variables[i];
+    if ((uint64_t)Variable.NameOffset + Variable.NameLength > this->Header->StringBytes) {
+      this->Error = "invalid variable " + to_string(i);
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t BinaryAstReader::GetRootCount() const {
+  return this->Header ? this->Header->RootCount : 0;
+}
+
+uint512 BinaryAstReader::GetConstant(uint32_t Index) const {
+  uint512 Value = 0;
+  auto& Constant = this->Constants[Index];
+  for (uint32_t i = Constant.Limbs; i > 0; i--) {
+    Value = (Value << 64) | this->Limbs[Constant.Offset + i - 1];
+  }
+  return Value;
+}
+
+/*
+  Rebuild the nodes in order (the children always come first) and return the roots. The
+  variables are stored by alias (or name), so Variables is keyed the same way; the map
+  expected by the Translator is keyed by symbolic variable name, it's filled if requested.
+*/
+
+vector<SharedAbstractNode> BinaryAstReader::Load(API& Api, map<string, SharedAbstractNode>& Variables, map<string, SharedAbstractNode>* SymbolicVariables) {
+  if (this->Header == nullptr) {
+    this->Error = "no file mapped";
+    return {};
+  }
+  auto Ctx = Api.getAstContext();
+  try {
+    // Resolve the variables
+    vector<SharedAbstractNode> VariableNodes;
+    for (uint64_t i = 0; i < this->Header->VariableCount; i++) {
+      auto& Variable = this->Variables[i];
+      string Name(this->Strings + Variable.NameOffset, Variable.NameLength);
+      auto Known = Variables.find(Name);
+      if (Known == Variables.end()) {
+        Known = Variables.emplace(Name, Ctx->variable(Api.newSymbolicVariable(Variable.Size, Name))).first;
+      } else if (Known->second->getBitvectorSize() != Variable.Size) {
+        this->Error = "conflicting size of variable " + Name;
+        return {};
+      }
+      VariableNodes.push_back(Known->second);
+      if (SymbolicVariables && Known->second->getType() == ast_e::VARIABLE_NODE) {
+        auto* Node = static_cast<VariableNode*>(Known->second.get());
+        (*SymbolicVariables)[Node->getSymbolicVariable()->getName()] = Known->second;
+      }
+    }
+    // Rebuild the nodes
+    vector<SharedAbstractNode> Built(this->Header->NodeCount);
+    vector<SharedAbstractNode> NodeChildren;
+    vector<uint512> Integers;
+    for (uint64_t i = 0; i < this->Header->NodeCount; i++) {
+      auto& Record = this->Nodes[i];
+      switch (Record.Type) {
+        case ast_e::BV_NODE:
+        case ast_e::INTEGER_NODE: {
+          if (Record.First >= this->Header->ConstantCount) {
+            this->Error = "invalid constant of node " + to_string(i);
+            return {};
+          }
+          // The integers are read by their parents
+          if (Record.Type == ast_e::BV_NODE) {
+            Built[i] = Ctx->bv(this->GetConstant(Record.First), Record.Size);
+          }
+        } break;
+        case ast_e::VARIABLE_NODE: {
+          if (Record.First >= VariableNodes.size()) {
+            this->Error = "invalid variable of node " + to_string(i);
+            return {};
+          }
+          Built[i] = VariableNodes[Record.First];
+        } break;
+        default: {
+          if ((uint64_t)Record.First + Record.Count > this->Header->ChildCount) {
+            this->Error = "invalid children of node " + to_string(i);
+            return {};
+          }
+          NodeChildren.clear();
+          Integers.clear();
+          for (uint32_t j = 0; j < Record.Count; j++) {
+            auto Child = this->Children[Record.First + j];
+            if (Child >= i) {
+              this->Error = "node " + to_string(i) + " is not in topological order";
+              return {};
+            }
+            bool IsInteger = (this->Nodes[Child].Type == ast_e::INTEGER_NODE);
+            NodeChildren.push_back(IsInteger ? nullptr : Built[Child]);
+            Integers.push_back(IsInteger ? this->GetConstant(this->Nodes[Child].First) : 0);
+          }
+          Built[i] = RebuildNode(Ctx, (ast_e)Record.Type, NodeChildren, Integers);
+          if (Built[i] == nullptr) {
+            this->Error = "unsupported node " + to_string(i);
+            return {};
+          }
+        } break;
+      }
+    }
+    // Fetch the roots
+    vector<SharedAbstractNode> Result;
+    for (uint64_t i = 0; i < this->Header->RootCount; i++) {
+      if (this->Roots[i] >= this->Header->NodeCount || Built[this->Roots[i]] == nullptr) {
+        this->Error = "invalid root " + to_string(i);
+        return {};
+      }
+      Result.push_back(Built[this->Roots[i]]);
+    }
+    return Result;
+  } catch (const exception& E) {
+    // Triton rejects the ill-sorted nodes
+    this->Error = E.what();
+    return {};
+  }
+}
+
+const string& BinaryAstReader::GetError() const {
+  return this->Error;
+}
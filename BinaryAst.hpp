@@ -0,0 +1,167 @@
+#ifndef BINARYAST_HPP
+#define BINARYAST_HPP
+
+// std
+#include <unordered_map>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+// triton
+#include <triton/api.hpp>
+
+/*
+  Compact binary format of a DAG of Triton ASTs (native byte order). After the header,
+  the sections are stored back to back, each one aligned to 8 bytes:
+  - nodes: fixed size records in topological order (children before parents);
+  - children: dense indexes of the children of each node;
+  - constants: shared pool of the constant values, as 64-bit limbs;
+  - variables: size and name of each variable (the names are in the string pool);
+  - roots: indexes of the root nodes;
+  - strings: pool of the variable names.
+  The records can be used in place, so the reader maps the file instead of parsing it.
+*/
+
+namespace BinaryAst {
+
+  // Magic value and version of the format
+  const char Magic[4] = { 'T', 'A', 'S', 'T' };
+  const uint32_t Version = 1;
+
+  typedef struct Header {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t NodeCount;
+    uint64_t ChildCount;
+    uint64_t ConstantCount;
+    uint64_t LimbCount;
+    uint64_t VariableCount;
+    uint64_t RootCount;
+    uint64_t StringBytes;
+  } Header;
+
+  typedef struct NodeRecord {
+    // Type of the node (ast_e)
+    uint32_t Type;
+    // Bitvector size of the node
+    uint32_t Size;
+    // First child (constant index for BV_NODE and INTEGER_NODE, variable index for VARIABLE_NODE)
+    uint32_t First;
+    // Number of children
+    uint32_t Count;
+  } NodeRecord;
+
+  typedef struct ConstantRecord {
+    // First limb (least significant first)
+    uint32_t Offset;
+    // Number of limbs
+    uint32_t Limbs;
+  } ConstantRecord;
+
+  typedef struct VariableRecord {
+    // Bitvector size of the variable
+    uint32_t Size;
+    // Name in the string pool
+    uint32_t NameOffset;
+    uint32_t NameLength;
+    uint32_t Reserved;
+  } VariableRecord;
+
+}
+
+/*
+  Writer collecting one or more roots; the nodes shared between them (and the constants
+  and the variables) are stored only once. References are written as the AST they point
+  to, and the constant sub-trees as a single constant.
+*/
+
+class BinaryAstWriter {
+private:
+
+  // Sections of the file
+  std::vector<BinaryAst::NodeRecord> Nodes;
+  std::vector<uint32_t> Children;
+  std::vector<BinaryAst::ConstantRecord> Constants;
+  std::vector<uint64_t> Limbs;
+  std::vector<BinaryAst::VariableRecord> Variables;
+  std::vector<uint32_t> Roots;
+  std::string Strings;
+
+  // Indexes of the written nodes, constants and variables
+  std::unordered_map<triton::ast::SharedAbstractNode, uint32_t> NodeIds;
+  std::map<triton::uint512, uint32_t> ConstantIds;
+  std::map<std::string, uint32_t> VariableIds;
+
+  // Add a constant to the pool
+  uint32_t AddConstant(const triton::uint512& Value);
+
+  // Add a variable to the table
+  uint32_t AddVariable(const std::string& Name, uint32_t Size);
+
+public:
+  // Add a root, returning its index in the roots
+  uint32_t Add(const triton::ast::SharedAbstractNode& Root);
+
+  // Write the file
+  bool Write(const std::string& Path) const;
+
+  // Write to a stream
+  bool Write(std::ostream& Output) const;
+};
+
+/*
+  Reader mapping a file in memory and rebuilding its roots in a Triton context.
+*/
+
+class BinaryAstReader {
+private:
+
+  // Mapped file
+  const uint8_t* Data;
+  size_t Length;
+
+  // Sections of the file
+  const BinaryAst::Header* Header;
+  const BinaryAst::NodeRecord* Nodes;
+  const uint32_t* Children;
+  const BinaryAst::ConstantRecord* Constants;
+  const uint64_t* Limbs;
+  const BinaryAst::VariableRecord* Variables;
+  const uint32_t* Roots;
+  const char* Strings;
+
+  // Last error
+  std::string Error;
+
+  // Validate the sections of the mapped file
+  bool Validate();
+
+public:
+  // Default constructor
+  BinaryAstReader();
+
+  // Default destructor (unmaps the file)
+  ~BinaryAstReader();
+
+  // Map a file
+  bool Open(const std::string& Path);
+
+  // Unmap the file
+  void Close();
+
+  // Get the number of roots
+  uint64_t GetRootCount() const;
+
+  // Get the value of a constant of the pool
+  triton::uint512 GetConstant(uint32_t Index) const;
+
+  // Rebuild the roots; the variables are looked up by their stored alias (or name) in Variables, or created,
+  // and SymbolicVariables (if given) receives them by symbolic variable name, as expected by the Translator
+  std::vector<triton::ast::SharedAbstractNode> Load(triton::API& Api, std::map<std::string, triton::ast::SharedAbstractNode>& Variables, std::map<std::string, triton::ast::SharedAbstractNode>* SymbolicVariables = nullptr);
+
+  // Get the last error
+  const std::string& GetError() const;
+};
+
+#endif
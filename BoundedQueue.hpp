@@ -0,0 +1,82 @@
+#ifndef BOUNDEDQUEUE_HPP
+#define BOUNDEDQUEUE_HPP
+
+// std
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <deque>
+
+/*
+  Multi-producer multi-consumer FIFO queue with a fixed capacity: the producers block
+  while it's full, the consumers block while it's empty. Once closed, the pushes fail
+  and the pops drain the remaining items.
+*/
+
+template <typename T>
+class BoundedQueue {
+private:
+
+  std::mutex Mutex;
+  std::condition_variable NotFull;
+  std::condition_variable NotEmpty;
+  std::deque<T> Items;
+  size_t Capacity;
+  bool Closed;
+
+public:
+  // Default constructor
+  BoundedQueue(size_t Capacity) : Capacity(Capacity ? Capacity : 1), Closed(false) {}
+
+  // Push an item, waiting for a free slot (false if the queue is closed)
+  bool Push(T Item) {
+    std::unique_lock<std::mutex> Lock(this->Mutex);
+    this->NotFull.wait(Lock, [this] { return this->Closed || this->Items.size() < this->Capacity; });
+    if (this->Closed) {
+      return false;
+    }
+    this->Items.push_back(std::move(Item));
+    this->NotEmpty.notify_one();
+    return true;
+  }
+
+  // Push an item only if there's a free slot (false if the queue is full or closed)
+  bool TryPush(T Item) {
+    std::lock_guard<std::mutex> Lock(this->Mutex);
+    if (this->Closed || this->Items.size() >= this->Capacity) {
+      return false;
+    }
+    this->Items.push_back(std::move(Item));
+    this->NotEmpty.notify_one();
+    return true;
+  }
+
+  // Pop an item, waiting for one (false if the queue is closed and empty)
+  bool Pop(T& Item) {
+    std::unique_lock<std::mutex> Lock(this->Mutex);
+    this->NotEmpty.wait(Lock, [this] { return this->Closed || !this->Items.empty(); });
+    if (this->Items.empty()) {
+      return false;
+    }
+    Item = std::move(this->Items.front());
+    this->Items.pop_front();
+    this->NotFull.notify_one();
+    return true;
+  }
+
+  // Close the queue, waking up all the waiting threads
+  void Close() {
+    std::lock_guard<std::mutex> Lock(this->Mutex);
+    this->Closed = true;
+    this->NotFull.notify_all();
+    this->NotEmpty.notify_all();
+  }
+
+  // Get the number of queued items
+  size_t Size() {
+    std::lock_guard<std::mutex> Lock(this->Mutex);
+    return this->Items.size();
+  }
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include <ContextPool.hpp>
+
+/*
+  Default constructor:
+  - we need the Triton context to build the Translator(s)
+  - the options configure when the context is rotated
+*/
+
+ContextPool::ContextPool(API& Api, const ContextPoolOptions& Options) : Api(Api), Options(Options), Translations(0), Instructions(0), Rotations(0), SharedCache(nullptr) {
+  // Allocate the first context
+  this->Context = make_shared<LLVMContext>();
+  this->Current = make_unique<Translator>(*this->Context, this->Api, this->Options.Translation);
+}
+
+/*
+  Switch to a fresh context, migrating the cache if requested.
+*/
+
+void ContextPool::Rotate() {
+  // Allocate the new context
+  auto NewContext = make_shared<LLVMContext>();
+  // Move the cached references as bitcode
+  map<ExpKey, shared_ptr<llvm::Module>> NewCache;
+  if (this->Options.MigrateCache) {
+    for (auto& Entry : this->Cache) {
+      auto Module = DeserializeModule(SerializeModule(*Entry.second), *NewContext);
+      if (Module) {
+        NewCache[Entry.first] = Module;
+      }
+    }
+  }
+  // Release the old state before the old context (unless still referenced by the callers)
+  this->Cache.clear();
+  this->Current.reset();
+  this->Context = NewContext;
+  this->Current = make_unique<Translator>(*this->Context, this->Api, this->Options.Translation);
+  this->Current->SetLimits(this->Limits);
+  this->Current->SetSharedCache(this->SharedCache);
+  this->Cache = std::move(NewCache);
+  // Reset the counters
+  this->Translations = 0;
+  this->Instructions = 0;
+  this->Rotations++;
+}
+
+/*
+  Rotate the context if it did enough work.
+*/
+
+void ContextPool::RotateIfNeeded() {
+  if ((this->Options.MaxTranslations && this->Translations >= this->Options.MaxTranslations) ||
+      (this->Options.MaxInstructions && this->Instructions >= this->Options.MaxInstructions)) {
+    this->Rotate();
+  }
+}
+
+/*
+  Lift a Triton AST to a LLVM-IR block with the current context.
+*/
+
+shared_ptr<llvm::Module> ContextPool::TritonAstToLLVMIR(const SharedAbstractNode& Node, ssize_t MaxDepth) {
+  // Rotate before starting, so the returned Module is never invalidated by this call
+  this->RotateIfNeeded();
+  auto Module = this->Current->TritonAstToLLVMIR(Node, this->Cache, MaxDepth);
+  if (Module == nullptr) {
+    return nullptr;
+  }
+  // Account the work done
+  this->Translations++;
+  this->Instructions += this->Current->GetLiftedInstructions();
+  // Keep the context alive as long as the Module is referenced
+  struct ModuleHandle {
+    shared_ptr<LLVMContext> Context;
+    shared_ptr<llvm::Module> Module;
+  };
+  auto Handle = make_shared<ModuleHandle>(ModuleHandle{ this->Context, Module });
+  return shared_ptr<llvm::Module>(Handle, Handle->Module.get());
+}
+
+/*
+  Lift a LLVM-IR block to a Triton AST.
+*/
+
+SharedAbstractNode ContextPool::LLVMIRToTritonAst(const shared_ptr<llvm::Module>& Module, map<string, SharedAbstractNode>& Variables, bool IsITE, bool IsLogical) {
+  return this->Current->LLVMIRToTritonAst(Module, Variables, IsITE, IsLogical);
+}
+
+/*
+  Simplify a Triton AST with the current context (the Modules never leave the pool).
+*/
+
+TranslationStatus ContextPool::Simplify(const SharedAbstractNode& Node, map<string, SharedAbstractNode>& Variables, SharedAbstractNode& Result, const TranslationLimits& Limits, ssize_t MaxDepth) {
+  this->RotateIfNeeded();
+  auto Status = this->Current->Simplify(Node, this->Cache, Variables, Result, Limits, MaxDepth);
+  // Account the work done
+  this->Translations++;
+  this->Instructions += this->Current->GetLiftedInstructions();
+  return Status;
+}
+
+/*
+  Simplify a Triton AST with the current context, printing the optimized block as SMT-LIB2.
+*/
+
+TranslationStatus ContextPool::SimplifyToSMTLIB(const SharedAbstractNode& Node, map<string, SharedAbstractNode>& Variables, string& Result, const TranslationLimits& Limits, ssize_t MaxDepth) {
+  this->RotateIfNeeded();
+  auto Status = this->Current->SimplifyToSMTLIB(Node, this->Cache, Variables, Result, Limits, MaxDepth);
+  // Account the work done
+  this->Translations++;
+  this->Instructions += this->Current->GetLiftedInstructions();
+  return Status;
+}
+
+/*
+  Set the limits and the shared cache of the current Translator (and of the next ones).
+*/
+
+void ContextPool::SetLimits(const TranslationLimits& Limits) {
+  this->Limits = Limits;
+  this->Current->SetLimits(Limits);
+}
+
+void ContextPool::SetSharedCache(SharedReferenceCache* Cache) {
+  this->SharedCache = Cache;
+  this->Current->SetSharedCache(Cache);
+}
+
+/*
+  Getters.
+*/
+
+uint64_t ContextPool::GetRotations() const {
+  return this->Rotations;
+}
+
+Translator& ContextPool::GetTranslator() {
+  return *this->Current;
+}
+
+map<ExpKey, shared_ptr<llvm::Module>>& ContextPool::GetCache() {
+  return this->Cache;
+}
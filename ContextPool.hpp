@@ -0,0 +1,95 @@
+#ifndef CONTEXTPOOL_HPP
+#define CONTEXTPOOL_HPP
+
+// translator
+#include <Translator.hpp>
+#include <ModuleBitcode.hpp>
+
+// strutures
+typedef struct ContextPoolOptions {
+  // Rotate the context after this many translations (0 disables the limit)
+  uint64_t MaxTranslations = 10000;
+  // Rotate the context after this many lifted instructions (0 disables the limit)
+  uint64_t MaxInstructions = 0;
+  // Migrate the cached references to the new context instead of dropping them
+  bool MigrateCache = true;
+  // Options of the pooled Translator(s)
+  TranslatorOptions Translation;
+} ContextPoolOptions;
+
+/*
+  Every translation leaves uniqued constants, types and metadata in the LLVMContext,
+  so a long running process can't keep using the same context forever. The pool owns
+  the context, the Translator and the reference cache, and rotates to a fresh context
+  once the configured amount of work has been done, migrating the cached Modules as
+  bitcode. The Modules returned to the callers keep their own context alive, so they
+  stay valid across the rotations.
+*/
+
+class ContextPool {
+private:
+
+  // Triton context shared by the Translator(s)
+  API& Api;
+
+  // Rotation policy
+  ContextPoolOptions Options;
+
+  // Current context, Translator and cache (declared in destruction order)
+  shared_ptr<LLVMContext> Context;
+  unique_ptr<Translator> Current;
+  map<ExpKey, shared_ptr<llvm::Module>> Cache;
+
+  // Work done with the current context
+  uint64_t Translations;
+  uint64_t Instructions;
+
+  // Number of rotations so far
+  uint64_t Rotations;
+
+  // Limits and shared cache given to every Translator (kept across the rotations)
+  TranslationLimits Limits;
+  SharedReferenceCache* SharedCache;
+
+  // Rotate the context if it did enough work
+  void RotateIfNeeded();
+
+public:
+  // Default constructor
+  ContextPool(API& Api, const ContextPoolOptions& Options = ContextPoolOptions());
+
+  // Default destructor
+  ~ContextPool() {};
+
+  // Lift a Triton AST to a LLVM-IR block (the Module keeps its context alive)
+  shared_ptr<llvm::Module> TritonAstToLLVMIR(const SharedAbstractNode& Node, ssize_t MaxDepth = -1);
+
+  // Lift a LLVM-IR block to a Triton AST (the Module may come from an old context)
+  SharedAbstractNode LLVMIRToTritonAst(const shared_ptr<llvm::Module>& Module, map<string, SharedAbstractNode>& Variables, bool IsITE = false, bool IsLogical = false);
+
+  // Simplify a Triton AST within limits (Result is the original AST unless successful)
+  TranslationStatus Simplify(const SharedAbstractNode& Node, map<string, SharedAbstractNode>& Variables, SharedAbstractNode& Result, const TranslationLimits& Limits, ssize_t MaxDepth = -1);
+
+  // Simplify a Triton AST within limits, printing it as a SMT-LIB2 term (Result is the original AST unless successful)
+  TranslationStatus SimplifyToSMTLIB(const SharedAbstractNode& Node, map<string, SharedAbstractNode>& Variables, string& Result, const TranslationLimits& Limits, ssize_t MaxDepth = -1);
+
+  // Switch to a fresh context
+  void Rotate();
+
+  // Set the limits checked by the following translations
+  void SetLimits(const TranslationLimits& Limits);
+
+  // Share the lifted references with the Translator(s) of other threads (nullptr to stop)
+  void SetSharedCache(SharedReferenceCache* Cache);
+
+  // Get the number of rotations so far
+  uint64_t GetRotations() const;
+
+  // Get the current Translator
+  Translator& GetTranslator();
+
+  // Get the current reference cache
+  map<ExpKey, shared_ptr<llvm::Module>>& GetCache();
+};
+
+#endif
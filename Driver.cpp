@@ -0,0 +1,371 @@
+// std
+#include <condition_variable>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <map>
+
+// translator
+#include <ContextPool.hpp>
+#include <BoundedQueue.hpp>
+#include <ExpressionParser.hpp>
+
+/*
+  Bulk driver: reads the expressions (SMT-LIB2 bitvector terms, as printed by Triton)
+  from files or stdin, simplifies them on a pool of worker threads and writes them in
+  the input order. The declarations and the other commands are copied to the output,
+  the 'assert' commands are simplified in place, so an SMT-LIB2 script stays valid.
+
+  Each worker owns its Triton API, LLVMContext and Translator (none of them is thread
+  safe), so the reader only moves text around. The number of expressions between the
+  reader and the writer is bounded, so the memory doesn't depend on the input size.
+*/
+
+typedef struct DriverOptions {
+  // Input files ('-' or none for stdin)
+  vector<string> Inputs;
+  // Output file (empty for stdout)
+  string Output;
+  // Number of worker threads
+  unsigned Threads = max(1u, thread::hardware_concurrency());
+  // Maximum number of expressions between the reader and the writer (0 = 64 per thread)
+  size_t InFlight = 0;
+  // Maximum depth of the lifted ASTs
+  ssize_t MaxDepth = -1;
+  // Limits of each expression (0 = unlimited)
+  uint64_t Timeout = 0;
+  uint64_t MaxNodes = 0;
+  uint64_t MaxInstructions = 0;
+  // Print the optimized LLVM-IR straight to SMT-LIB2 (with 'let') instead of rebuilding a Triton AST
+  bool DirectSMTLIB = false;
+  // Options of the Translator(s)
+  TranslatorOptions Translation;
+} DriverOptions;
+
+typedef struct DriverJob {
+  // Position in the output
+  uint64_t Index = 0;
+  // Number of declarations visible to the expression
+  uint64_t Declarations = 0;
+  // Expression text
+  string Text;
+  // The expression is the body of an 'assert' command
+  bool Assertion = false;
+} DriverJob;
+
+/*
+  Writer emitting the results in the input order. The reader reserves a position for
+  each form and waits while too many of them are pending.
+*/
+
+class OrderedOutput {
+private:
+
+  mutex Mutex;
+  condition_variable NotFull;
+  ostream& Output;
+  map<uint64_t, string> Pending;
+  uint64_t Next = 0;
+  uint64_t Reserved = 0;
+  size_t MaxInFlight;
+
+public:
+  OrderedOutput(ostream& Output, size_t MaxInFlight) : Output(Output), MaxInFlight(MaxInFlight) {}
+
+  // Reserve the next position, waiting while too many results are pending
+  uint64_t Reserve() {
+    unique_lock<mutex> Lock(this->Mutex);
+    this->NotFull.wait(Lock, [this] { return this->Reserved - this->Next < this->MaxInFlight; });
+    return this->Reserved++;
+  }
+
+  // Complete a position, writing all the consecutive completed ones
+  void Complete(uint64_t Index, string Text) {
+    lock_guard<mutex> Lock(this->Mutex);
+    this->Pending[Index] = std::move(Text);
+    while (!this->Pending.empty() && this->Pending.begin()->first == this->Next) {
+      this->Output << this->Pending.begin()->second << '\n';
+      this->Pending.erase(this->Pending.begin());
+      this->Next++;
+    }
+    this->NotFull.notify_all();
+  }
+};
+
+/*
+  Append-only list of the declarations, shared by the workers.
+*/
+
+class DeclarationList {
+private:
+
+  mutex Mutex;
+  vector<string> Forms;
+
+public:
+  // Add a declaration, returning the number of declarations
+  uint64_t Add(string Form) {
+    lock_guard<mutex> Lock(this->Mutex);
+    this->Forms.push_back(std::move(Form));
+    return this->Forms.size();
+  }
+
+  // Get the declarations in [Begin, End)
+  vector<string> Get(uint64_t Begin, uint64_t End) {
+    lock_guard<mutex> Lock(this->Mutex);
+    return vector<string>(this->Forms.begin() + Begin, this->Forms.begin() + End);
+  }
+};
+
+/*
+  Statistics of the whole run.
+*/
+
+typedef struct DriverStatistics {
+  atomic<uint64_t> Expressions{ 0 };
+  atomic<uint64_t> ParseErrors{ 0 };
+  atomic<uint64_t> Statuses[(size_t)TranslationStatus::Failed + 1]{};
+} DriverStatistics;
+
+static void Usage(const char* Name) {
+  cerr << "Usage: " << Name << " [options] [input...]\n"
+       << "  -o FILE              write the output to FILE (default: stdout)\n"
+       << "  -j N                 number of worker threads (default: hardware threads)\n"
+       << "  --in-flight N        maximum number of pending expressions (default: 64 per thread)\n"
+       << "  --max-depth N        cut the ASTs deeper than N into variables\n"
+       << "  --timeout MS         give up on an expression after MS milliseconds\n"
+       << "  --max-nodes N        give up on an expression with more than N nodes\n"
+       << "  --max-instructions N give up on an expression lifted to more than N instructions\n"
+       << "  --iterations N       repeat the optimization pipeline up to N times\n"
+       << "  --truth-table        replace the known MBA shapes before lifting\n"
+       << "  --direct             print the optimized IR as SMT-LIB2, sharing subterms with 'let'\n"
+       << "Reads the expressions from the inputs (or stdin) and writes them simplified.\n";
+}
+
+static bool ParseArguments(int argc, char** argv, DriverOptions& Options) {
+  for (int i = 1; i < argc; i++) {
+    string Arg = argv[i];
+    // Fetch the value of an option
+    auto Value = [&](uint64_t& Out) {
+      if (i + 1 >= argc) {
+        cerr << "Missing value for " << Arg << endl;
+        return false;
+      }
+      try {
+        Out = stoull(argv[++i]);
+      } catch (const exception&) {
+        cerr << "Invalid value for " << Arg << ": " << argv[i] << endl;
+        return false;
+      }
+      return true;
+    };
+    uint64_t N = 0;
+    if (Arg == "-h" || Arg == "--help") {
+      return false;
+    } else if (Arg == "-o") {
+      if (i + 1 >= argc) {
+        cerr << "Missing value for " << Arg << endl;
+        return false;
+      }
+      Options.Output = argv[++i];
+    } else if (Arg == "-j") {
+      if (!Value(N) || N == 0) return false;
+      Options.Threads = N;
+    } else if (Arg == "--in-flight") {
+      if (!Value(N)) return false;
+      Options.InFlight = N;
+    } else if (Arg == "--max-depth") {
+      if (!Value(N)) return false;
+      Options.MaxDepth = N;
+    } else if (Arg == "--timeout") {
+      if (!Value(Options.Timeout)) return false;
+    } else if (Arg == "--max-nodes") {
+      if (!Value(Options.MaxNodes)) return false;
+    } else if (Arg == "--max-instructions") {
+      if (!Value(Options.MaxInstructions)) return false;
+    } else if (Arg == "--iterations") {
+      if (!Value(N) || N == 0) return false;
+      Options.Translation.MaxOptimizationIterations = N;
+    } else if (Arg == "--truth-table") {
+      Options.Translation.TruthTableLookup = true;
+    } else if (Arg == "--direct") {
+      Options.DirectSMTLIB = true;
+    } else if (Arg.size() > 1 && Arg[0] == '-') {
+      cerr << "Unknown option: " << Arg << endl;
+      return false;
+    } else {
+      Options.Inputs.push_back(Arg);
+    }
+  }
+  if (Options.Inputs.empty()) {
+    Options.Inputs.push_back("-");
+  }
+  if (Options.InFlight == 0) {
+    Options.InFlight = 64 * Options.Threads;
+  }
+  return true;
+}
+
+/*
+  Worker loop: parse, simplify and print the expressions with its own contexts.
+*/
+
+static void Worker(const DriverOptions& Options, BoundedQueue<DriverJob>& Jobs, DeclarationList& Declarations, OrderedOutput& Output, DriverStatistics& Statistics) {
+  // Allocate the contexts of this thread
+  API Api;
+  Api.setArchitecture(triton::arch::ARCH_X86_64);
+  ContextPoolOptions PoolOptions;
+  PoolOptions.Translation = Options.Translation;
+  ContextPool Pool(Api, PoolOptions);
+  ExpressionParser Parser(Api);
+  uint64_t Declared = 0;
+  DriverJob Job;
+  while (Jobs.Pop(Job)) {
+    // Catch up with the declarations (the invalid ones surface as unknown symbols)
+    if (Job.Declarations > Declared) {
+      for (auto& Form : Declarations.Get(Declared, Job.Declarations)) {
+        Parser.Declare(Form);
+      }
+      Declared = Job.Declarations;
+    }
+    string Text = Job.Text;
+    auto Node = Parser.Parse(Job.Text);
+    if (Node == nullptr) {
+      cerr << "Expression " << Job.Index << ": " << Parser.GetError() << endl;
+      Statistics.ParseErrors++;
+    } else {
+      // Simplify within the limits (the original AST is kept on failure)
+      TranslationLimits Limits;
+      if (Options.Timeout) {
+        Limits.Deadline = chrono::steady_clock::now() + chrono::milliseconds(Options.Timeout);
+      }
+      Limits.MaxNodes = Options.MaxNodes;
+      Limits.MaxInstructions = Options.MaxInstructions;
+      TranslationStatus Status;
+      try {
+        if (Options.DirectSMTLIB) {
+          Status = Pool.SimplifyToSMTLIB(Node, Parser.GetVariables(), Text, Limits, Options.MaxDepth);
+        } else {
+          SharedAbstractNode Result;
+          Status = Pool.Simplify(Node, Parser.GetVariables(), Result, Limits, Options.MaxDepth);
+          stringstream ss;
+          ss << Result;
+          Text = ss.str();
+        }
+      } catch (const exception& E) {
+        // A Triton exception (e.g. a failed size check) only fails this expression
+        cerr << "Expression " << Job.Index << ": " << E.what() << endl;
+        Status = TranslationStatus::Failed;
+        Text = Job.Text;
+      }
+      Statistics.Statuses[(size_t)Status]++;
+    }
+    Statistics.Expressions++;
+    Output.Complete(Job.Index, Job.Assertion ? "(assert " + Text + ")" : Text);
+  }
+}
+
+int main(int argc, char** argv) {
+  DriverOptions Options;
+  if (!ParseArguments(argc, argv, Options)) {
+    Usage(argv[0]);
+    return 1;
+  }
+  // Open the output; the diagnostics printed by the library go to stderr
+  ofstream OutputFile;
+  if (!Options.Output.empty()) {
+    OutputFile.open(Options.Output);
+    if (!OutputFile) {
+      cerr << "Can't open " << Options.Output << endl;
+      return 1;
+    }
+  }
+  ostream OutputStream(Options.Output.empty() ? cout.rdbuf() : OutputFile.rdbuf());
+  auto* StandardOutput = cout.rdbuf(cerr.rdbuf());
+  // Start the workers
+  auto Start = chrono::steady_clock::now();
+  BoundedQueue<DriverJob> Jobs(Options.InFlight);
+  DeclarationList Declarations;
+  OrderedOutput Output(OutputStream, Options.InFlight);
+  DriverStatistics Statistics;
+  vector<thread> Workers;
+  for (unsigned i = 0; i < Options.Threads; i++) {
+    Workers.emplace_back(Worker, cref(Options), ref(Jobs), ref(Declarations), ref(Output), ref(Statistics));
+  }
+  // Commands copied to the output as they are
+  static const set<string> Commands = {
+    "set-logic", "set-option", "set-info", "get-option", "get-info", "check-sat", "check-sat-assuming",
+    "get-model", "get-value", "get-assertions", "get-unsat-core", "push", "pop", "reset",
+    "reset-assertions", "echo", "exit", "declare-sort", "define-sort", "define-const"
+  };
+  // Split the inputs in forms and dispatch them
+  uint64_t Declared = 0;
+  uint64_t Bytes = 0;
+  for (auto& Input : Options.Inputs) {
+    ifstream File;
+    if (Input != "-") {
+      File.open(Input, ios::binary);
+      if (!File) {
+        cerr << "Can't open " << Input << endl;
+        continue;
+      }
+    }
+    FormReader Reader(Input == "-" ? cin : File);
+    string Form;
+    while (Reader.Next(Form)) {
+      auto Index = Output.Reserve();
+      auto Head = ExpressionParser::GetHead(Form);
+      if (ExpressionParser::IsDeclaration(Form)) {
+        Declared = Declarations.Add(Form);
+        Output.Complete(Index, Form);
+      } else if (Head == "assert") {
+        // Simplify the body of the assertion
+        DriverJob Job;
+        Job.Index = Index;
+        Job.Declarations = Declared;
+        Job.Text = Form.substr(Form.find("assert") + 6);
+        Job.Text.erase(Job.Text.find_last_of(')'));
+        Job.Assertion = true;
+        Jobs.Push(std::move(Job));
+      } else if (Commands.find(Head) == Commands.end()) {
+        // Simplify the bare term
+        DriverJob Job;
+        Job.Index = Index;
+        Job.Declarations = Declared;
+        Job.Text = Form;
+        Jobs.Push(std::move(Job));
+      } else {
+        // Copy the other commands
+        Output.Complete(Index, Form);
+      }
+    }
+    Bytes += Reader.GetBytesRead();
+  }
+  // Wait for the workers
+  Jobs.Close();
+  for (auto& Worker : Workers) {
+    Worker.join();
+  }
+  OutputStream.flush();
+  cout.rdbuf(StandardOutput);
+  // Print the summary
+  double Elapsed = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+  uint64_t Expressions = Statistics.Expressions;
+  cerr << "Expressions: " << Expressions << " (" << Statistics.ParseErrors << " parse errors)" << endl;
+  for (size_t i = 0; i <= (size_t)TranslationStatus::Failed; i++) {
+    if (Statistics.Statuses[i]) {
+      cerr << "  " << Translator::GetStatusName((TranslationStatus)i) << ": " << Statistics.Statuses[i] << endl;
+    }
+  }
+  cerr << fixed << setprecision(3);
+  cerr << "Elapsed: " << Elapsed << " s with " << Options.Threads << " thread(s)" << endl;
+  cerr << "Throughput: " << (Elapsed > 0 ? Expressions / Elapsed : 0) << " expressions/s, ";
+  cerr << (Elapsed > 0 ? Bytes / Elapsed / (1 << 20) : 0) << " MiB/s" << endl;
+  return 0;
+}
@@ -0,0 +1,761 @@
+#include <ExpressionParser.hpp>
+
+// std
+#include <cctype>
+
+using namespace std;
+using namespace triton;
+using namespace triton::ast;
+
+/*
+  Default constructor:
+  - the stream is consumed in chunks of the given size
+*/
+
+FormReader::FormReader(istream& Input, size_t ChunkSize) : Input(Input), Buffer(ChunkSize), Position(0), Size(0), BytesRead(0) {}
+
+bool FormReader::Peek(char& C) {
+  if (this->Position == this->Size) {
+    // Refill the chunk
+    this->Input.read(this->Buffer.data(), this->Buffer.size());
+    this->Size = this->Input.gcount();
+    this->Position = 0;
+    if (this->Size == 0) {
+      return false;
+    }
+  }
+  C = this->Buffer[this->Position];
+  return true;
+}
+
+bool FormReader::Get(char& C) {
+  if (!this->Peek(C)) {
+    return false;
+  }
+  this->Position++;
+  this->BytesRead++;
+  return true;
+}
+
+/*
+  Read the next top-level form: a balanced list or a single atom. Quoted symbols and
+  strings are copied as they are, comments are dropped.
+*/
+
+bool FormReader::Next(string& Form) {
+  Form.clear();
+  char C;
+  int64_t Depth = 0;
+  while (this->Get(C)) {
+    if (C == ';') {
+      // Skip the comment
+      while (this->Get(C) && C != '\n');
+      C = '\n';
+    }
+    if (isspace((unsigned char)C)) {
+      if (Form.empty()) {
+        continue;
+      }
+      // Whitespace ends a top-level atom
+      if (Depth == 0) {
+        return true;
+      }
+      if (Form.back() != ' ') {
+        Form.push_back(' ');
+      }
+      continue;
+    }
+    if (C == '|' || C == '"') {
+      // Copy the quoted symbol or string
+      char Quote = C;
+      Form.push_back(C);
+      while (this->Get(C)) {
+        Form.push_back(C);
+        if (C == Quote) {
+          break;
+        }
+      }
+    } else {
+      Form.push_back(C);
+      Depth += (C == '(') ? 1 : (C == ')') ? -1 : 0;
+    }
+    if (Depth <= 0) {
+      // A list is complete when its parenthesis is closed
+      if (C == ')') {
+        return true;
+      }
+      // A top-level atom ends before a parenthesis
+      if (this->Peek(C) && (C == '(' || C == ')')) {
+        return true;
+      }
+    }
+  }
+  return !Form.empty();
+}
+
+/*
+  Read the next token, without collecting the whole form.
+*/
+
+bool FormReader::NextToken(string& Token) {
+  Token.clear();
+  char C;
+  // Skip the whitespace and the comments
+  while (true) {
+    if (!this->Get(C)) {
+      return false;
+    }
+    if (C == ';') {
+      while (this->Get(C) && C != '\n');
+    } else if (!isspace((unsigned char)C)) {
+      break;
+    }
+  }
+  Token.push_back(C);
+  if (C == '(' || C == ')') {
+    return true;
+  }
+  if (C == '|' || C == '"') {
+    // Copy the quoted symbol or string
+    char Quote = C;
+    while (this->Get(C)) {
+      Token.push_back(C);
+      if (C == Quote) {
+        break;
+      }
+    }
+    return true;
+  }
+  // Read the atom up to a delimiter
+  while (this->Peek(C) && !isspace((unsigned char)C) && C != '(' && C != ')' && C != ';') {
+    this->Get(C);
+    Token.push_back(C);
+  }
+  return true;
+}
+
+uint64_t FormReader::GetBytesRead() const {
+  return this->BytesRead;
+}
+
+/*
+  Default constructor:
+  - we need the Triton context to build the nodes
+  - the 'let' bindings can become references to symbolic expressions (which are never
+    released by the API, so it's better suited to bounded inputs)
+  - the structurally identical terms are shared up to the given number of nodes
+*/
+
+ExpressionParser::ExpressionParser(API& Api, bool LetAsReferences, size_t MaxSharedNodes) : Api(Api), LetAsReferences(LetAsReferences), MaxSharedNodes(MaxSharedNodes) {}
+
+/*
+  Strip the bars of a quoted symbol ('|x|' and 'x' are the same symbol).
+*/
+
+static string Unquote(const string& Symbol) {
+  if (Symbol.size() > 1 && Symbol.front() == '|' && Symbol.back() == '|') {
+    return Symbol.substr(1, Symbol.size() - 2);
+  }
+  return Symbol;
+}
+
+/*
+  Split a text in tokens: parentheses, quoted symbols and atoms.
+*/
+
+vector<string> ExpressionParser::Tokenize(const string& Text) {
+  vector<string> Tokens;
+  size_t i = 0;
+  while (i < Text.size()) {
+    char C = Text[i];
+    if (isspace((unsigned char)C)) {
+      i++;
+    } else if (C == ';') {
+      while (i < Text.size() && Text[i] != '\n') i++;
+    } else if (C == '(' || C == ')') {
+      Tokens.emplace_back(1, C);
+      i++;
+    } else if (C == '|') {
+      auto End = Text.find('|', i + 1);
+      End = (End == string::npos) ? Text.size() : End + 1;
+      Tokens.push_back(Text.substr(i, End - i));
+      i = End;
+    } else {
+      size_t Start = i;
+      while (i < Text.size() && !isspace((unsigned char)Text[i]) && Text[i] != '(' && Text[i] != ')') i++;
+      Tokens.push_back(Text.substr(Start, i - Start));
+    }
+  }
+  return Tokens;
+}
+
+/*
+  Helpers to inspect the top-level forms.
+*/
+
+string ExpressionParser::GetHead(const string& Form) {
+  auto Tokens = Tokenize(Form.substr(0, 64));
+  if (Tokens.size() < 2 || Tokens[0] != "(") {
+    return "";
+  }
+  return Tokens[1];
+}
+
+bool ExpressionParser::IsDeclaration(const string& Form) {
+  auto Head = GetHead(Form);
+  return Head == "declare-fun" || Head == "declare-const" || Head == "define-fun";
+}
+
+/*
+  Read a sort: '(_ BitVec SIZE)' or 'Bool'.
+*/
+
+bool ExpressionParser::Sort(const TokenSource& Next, uint32& Size) {
+  string Token;
+  if (!Next(Token)) {
+    this->Error = "expected a sort";
+    return false;
+  }
+  if (Token == "Bool") {
+    Size = 0;
+    return true;
+  }
+  vector<string> Tokens = { Token };
+  for (size_t i = 0; i < 4 && Next(Token); i++) {
+    Tokens.push_back(Token);
+  }
+  if (Tokens.size() != 5 || Tokens[0] != "(" || Tokens[1] != "_" || Tokens[2] != "BitVec" || Tokens[4] != ")" ||
+      Tokens[3].empty() || Tokens[3].find_first_not_of("0123456789") != string::npos) {
+    this->Error = "unsupported sort";
+    return false;
+  }
+  Size = (uint32)stoul(Tokens[3]);
+  return true;
+}
+
+/*
+  Handle a declaration or a definition, reading its tokens up to the closing parenthesis:
+  - declare-fun NAME () (_ BitVec SIZE))
+  - declare-const NAME (_ BitVec SIZE))
+  - define-fun NAME () SORT TERM)
+*/
+
+bool ExpressionParser::Command(const string& Name, const TokenSource& Next) {
+  string Token;
+  auto Expect = [&](const char* Expected) {
+    if (!Next(Token) || Token != Expected) {
+      this->Error = Name + ": expected '" + Expected + "'";
+      return false;
+    }
+    return true;
+  };
+  string Symbol;
+  if (!Next(Symbol)) {
+    this->Error = Name + ": expected a name";
+    return false;
+  }
+  Symbol = Unquote(Symbol);
+  // Only the functions without arguments are supported
+  if (Name != "declare-const" && (!Expect("(") || !Expect(")"))) {
+    return false;
+  }
+  uint32 Size = 0;
+  if (!this->Sort(Next, Size)) {
+    return false;
+  }
+  if (Name == "define-fun") {
+    // Bind the name to its term
+    auto Term = this->ParseTerm(Next);
+    if (Term == nullptr || !Expect(")")) {
+      return false;
+    }
+    this->Declared[Symbol] = Term;
+    return true;
+  }
+  if (!Expect(")")) {
+    return false;
+  }
+  if (Size == 0) {
+    this->Error = Name + ": only bitvector variables are supported";
+    return false;
+  }
+  // Redeclaring a variable with the same size is harmless
+  auto Known = this->Declared.find(Symbol);
+  if (Known != this->Declared.end()) {
+    if (Known->second->getType() != ast_e::VARIABLE_NODE || Known->second->getBitvectorSize() != Size) {
+      this->Error = "conflicting declaration of " + Symbol;
+      return false;
+    }
+    return true;
+  }
+  auto SymVar = this->Api.newSymbolicVariable(Size, Symbol);
+  auto Node = this->Api.getAstContext()->variable(SymVar);
+  this->Declared[Symbol] = Node;
+  this->Variables[SymVar->getName()] = Node;
+  return true;
+}
+
+/*
+  Declare a variable, or define a constant, from the text of its command.
+*/
+
+bool ExpressionParser::Declare(const string& Form) {
+  auto Tokens = Tokenize(Form);
+  if (Tokens.size() < 2 || Tokens[0] != "(" || !IsDeclaration(Form)) {
+    this->Error = "unsupported declaration: " + Form;
+    return false;
+  }
+  size_t Position = 2;
+  TokenSource Next = [&](string& Token) {
+    if (Position >= Tokens.size()) {
+      return false;
+    }
+    Token = Tokens[Position++];
+    return true;
+  };
+  try {
+    if (!this->Command(Tokens[1], Next)) {
+      return false;
+    }
+  } catch (const exception& E) {
+    this->Error = E.what();
+    return false;
+  }
+  if (Position != Tokens.size()) {
+    this->Error = "unexpected tokens after the declaration: " + Form;
+    return false;
+  }
+  return true;
+}
+
+/*
+  Build the node of an atom: a literal (#x, #b, true, false) or a declared variable.
+*/
+
+SharedAbstractNode ExpressionParser::Atom(const string& Token) {
+  auto Ctx = this->Api.getAstContext();
+  if (Token.size() > 2 && Token[0] == '#' && (Token[1] == 'x' || Token[1] == 'b')) {
+    uint32 Bits = (Token[1] == 'x') ? 4 : 1;
+    uint32 Size = (Token.size() - 2) * Bits;
+    if (Size > 512) {
+      this->Error = "literal too wide: " + Token;
+      return nullptr;
+    }
+    uint512 Value = 0;
+    for (size_t i = 2; i < Token.size(); i++) {
+      if (!isxdigit((unsigned char)Token[i]) || (Bits == 1 && Token[i] != '0' && Token[i] != '1')) {
+        this->Error = "invalid literal: " + Token;
+        return nullptr;
+      }
+      Value = (Value << Bits) | (isdigit((unsigned char)Token[i]) ? Token[i] - '0' : tolower(Token[i]) - 'a' + 10);
+    }
+    // Share the identical literals
+    auto& Literal = this->Shared[Token];
+    if (Literal == nullptr) {
+      Literal = Ctx->bv(Value, Size);
+    }
+    return Literal;
+  }
+  if (Token == "true") {
+    return Ctx->equal(Ctx->bvtrue(), Ctx->bvtrue());
+  }
+  if (Token == "false") {
+    return Ctx->lnot(Ctx->equal(Ctx->bvtrue(), Ctx->bvtrue()));
+  }
+  auto Name = Unquote(Token);
+  // The innermost 'let' binding hides the outer ones and the declarations
+  auto Binding = this->Bound.find(Name);
+  if (Binding != this->Bound.end() && !Binding->second.empty()) {
+    return Binding->second.back();
+  }
+  auto Known = this->Declared.find(Name);
+  if (Known == this->Declared.end()) {
+    this->Error = "unknown symbol: " + Token;
+    return nullptr;
+  }
+  return Known->second;
+}
+
+/*
+  Build the node of an operator applied to its arguments, sharing the identical ones.
+*/
+
+SharedAbstractNode ExpressionParser::Build(const string& Op, const vector<uint32>& Indices, const vector<SharedAbstractNode>& Args) {
+  // The key is the operator, the indexes and the identity of the arguments
+  string Key = Op;
+  for (auto Index : Indices) {
+    Key += ":" + to_string(Index);
+  }
+  for (auto& Arg : Args) {
+    auto* Pointer = Arg.get();
+    Key.append((const char*)&Pointer, sizeof(Pointer));
+  }
+  auto Known = this->Shared.find(Key);
+  if (Known != this->Shared.end()) {
+    return Known->second;
+  }
+  auto Node = this->BuildNode(Op, Indices, Args);
+  if (Node) {
+    // Keep the memory bounded
+    if (this->Shared.size() >= this->MaxSharedNodes) {
+      this->Shared.clear();
+    }
+    this->Shared[Key] = Node;
+  }
+  return Node;
+}
+
+/*
+  Build the node of an operator applied to its arguments.
+*/
+
+SharedAbstractNode ExpressionParser::BuildNode(const string& Op, const vector<uint32>& Indices, const vector<SharedAbstractNode>& Args) {
+  using BinaryMethod = SharedAbstractNode (AstContext::*)(const SharedAbstractNode&, const SharedAbstractNode&);
+  // Binary operators (the associative ones accept more arguments)
+  static const map<string, pair<BinaryMethod, bool>> BinaryOps = {
+    { "bvadd", { &AstContext::bvadd, true } },
+    { "bvand", { &AstContext::bvand, true } },
+    { "bvmul", { &AstContext::bvmul, true } },
+    { "bvor", { &AstContext::bvor, true } },
+    { "bvxor", { &AstContext::bvxor, true } },
+    { "bvashr", { &AstContext::bvashr, false } },
+    { "bvlshr", { &AstContext::bvlshr, false } },
+    { "bvnand", { &AstContext::bvnand, false } },
+    { "bvnor", { &AstContext::bvnor, false } },
+    { "bvsdiv", { &AstContext::bvsdiv, false } },
+    { "bvsge", { &AstContext::bvsge, false } },
+    { "bvsgt", { &AstContext::bvsgt, false } },
+    { "bvshl", { &AstContext::bvshl, false } },
+    { "bvsle", { &AstContext::bvsle, false } },
+    { "bvslt", { &AstContext::bvslt, false } },
+    { "bvsmod", { &AstContext::bvsmod, false } },
+    { "bvsrem", { &AstContext::bvsrem, false } },
+    { "bvsub", { &AstContext::bvsub, false } },
+    { "bvudiv", { &AstContext::bvudiv, false } },
+    { "bvuge", { &AstContext::bvuge, false } },
+    { "bvugt", { &AstContext::bvugt, false } },
+    { "bvule", { &AstContext::bvule, false } },
+    { "bvult", { &AstContext::bvult, false } },
+    { "bvurem", { &AstContext::bvurem, false } },
+    { "bvxnor", { &AstContext::bvxnor, false } },
+    { "=", { &AstContext::equal, false } },
+    { "distinct", { &AstContext::distinct, false } },
+    { "iff", { &AstContext::iff, false } },
+  };
+  auto Ctx = this->Api.getAstContext();
+  auto Arity = [&](size_t Expected) {
+    if (Args.size() != Expected) {
+      this->Error = Op + ": expected " + to_string(Expected) + " argument(s), got " + to_string(Args.size());
+      return false;
+    }
+    return true;
+  };
+  auto Binary = BinaryOps.find(Op);
+  if (Binary != BinaryOps.end() && Indices.empty()) {
+    auto Method = Binary->second.first;
+    if (Args.size() < 2 || (!Binary->second.second && Args.size() != 2)) {
+      this->Error = Op + ": expected 2 arguments, got " + to_string(Args.size());
+      return nullptr;
+    }
+    auto Node = ((*Ctx).*Method)(Args[0], Args[1]);
+    for (size_t i = 2; i < Args.size(); i++) {
+      Node = ((*Ctx).*Method)(Node, Args[i]);
+    }
+    return Node;
+  }
+  if (Op == "bvnot" && Arity(1)) {
+    return Ctx->bvnot(Args[0]);
+  }
+  if (Op == "bvneg" && Arity(1)) {
+    return Ctx->bvneg(Args[0]);
+  }
+  if (Op == "not" && Arity(1)) {
+    return Ctx->lnot(Args[0]);
+  }
+  if (Op == "ite" && Arity(3)) {
+    return Ctx->ite(Args[0], Args[1], Args[2]);
+  }
+  if (Op == "concat" && !Args.empty()) {
+    return (Args.size() == 1) ? Args[0] : Ctx->concat(Args);
+  }
+  if (Op == "and" && !Args.empty()) {
+    return (Args.size() == 1) ? Args[0] : Ctx->land(Args);
+  }
+  if (Op == "or" && !Args.empty()) {
+    return (Args.size() == 1) ? Args[0] : Ctx->lor(Args);
+  }
+  // Indexed operators
+  if (Op == "extract" && Indices.size() == 2 && Arity(1)) {
+    return Ctx->extract(Indices[0], Indices[1], Args[0]);
+  }
+  if (Op == "zero_extend" && Indices.size() == 1 && Arity(1)) {
+    return Ctx->zx(Indices[0], Args[0]);
+  }
+  if (Op == "sign_extend" && Indices.size() == 1 && Arity(1)) {
+    return Ctx->sx(Indices[0], Args[0]);
+  }
+  if (Op == "rotate_left" && Indices.size() == 1 && Arity(1)) {
+    return Ctx->bvrol(Args[0], Indices[0]);
+  }
+  if (Op == "rotate_right" && Indices.size() == 1 && Arity(1)) {
+    return Ctx->bvror(Args[0], Indices[0]);
+  }
+  if (this->Error.empty()) {
+    this->Error = "unsupported operator: " + Op;
+  }
+  return nullptr;
+}
+
+/*
+  Remove the 'let' scopes left by an aborted parse.
+*/
+
+void ExpressionParser::ClearScopes() {
+  this->Bound.clear();
+  this->Scopes.clear();
+}
+
+/*
+  Parse a term from a text.
+*/
+
+SharedAbstractNode ExpressionParser::Parse(const string& Text) {
+  auto Tokens = Tokenize(Text);
+  size_t Position = 0;
+  auto Node = this->ParseTerm([&](string& Token) {
+    if (Position >= Tokens.size()) {
+      return false;
+    }
+    Token = Tokens[Position++];
+    return true;
+  });
+  if (Node && Position != Tokens.size()) {
+    this->Error = "expected a single term";
+    return nullptr;
+  }
+  return Node;
+}
+
+/*
+  Parse exactly one term without recursion (the printed ASTs can be very deep): each open
+  list is a frame collecting its items, which is reduced when it's closed. The atoms are
+  resolved as soon as they are read, so they always see the 'let' bindings in scope.
+*/
+
+SharedAbstractNode ExpressionParser::ParseTerm(const TokenSource& Next) {
+  // Kinds of list
+  enum class FrameKind { Root, Term, Let, Bindings, Binding };
+  // Item of a list: an atom, a parsed node or an indexed operator
+  typedef struct Item {
+    string Atom;
+    SharedAbstractNode Node;
+    bool Indexed = false;
+    vector<uint32> Indices;
+  } Item;
+  typedef struct Frame {
+    FrameKind Kind;
+    vector<Item> Items;
+  } Frame;
+  this->Error.clear();
+  this->ClearScopes();
+  auto Ctx = this->Api.getAstContext();
+  // Abort the parse
+  auto Fail = [&](const string& Message) -> SharedAbstractNode {
+    if (this->Error.empty()) {
+      this->Error = Message;
+    }
+    this->ClearScopes();
+    return nullptr;
+  };
+  try {
+    vector<Frame> Frames = { { FrameKind::Root, {} } };
+    string Token;
+    while (Frames.size() > 1 || Frames[0].Items.empty()) {
+      if (!Next(Token)) {
+        return Fail("unexpected end of the term");
+      }
+      auto& Top = Frames.back();
+      if (Token == "(") {
+        // The lists right after 'let' are its bindings
+        auto Kind = FrameKind::Term;
+        if (Top.Kind == FrameKind::Let && Top.Items.size() == 1) {
+          Kind = FrameKind::Bindings;
+        } else if (Top.Kind == FrameKind::Bindings) {
+          Kind = FrameKind::Binding;
+        }
+        Frames.push_back({ Kind, {} });
+        continue;
+      }
+      if (Token != ")") {
+        Item Atom;
+        Atom.Atom = Token;
+        // Keep the operators, the indexes and the bound names, resolve the other atoms
+        bool IsSymbol = (Top.Kind == FrameKind::Term && (Top.Items.empty() || Top.Items[0].Atom == "_")) || (Top.Kind == FrameKind::Binding && Top.Items.empty());
+        if (Top.Kind == FrameKind::Term && Top.Items.empty() && Token == "let") {
+          Top.Kind = FrameKind::Let;
+        }
+        if (!IsSymbol) {
+          Atom.Node = this->Atom(Token);
+          if (Atom.Node == nullptr) {
+            return Fail("unknown symbol: " + Token);
+          }
+        }
+        Top.Items.push_back(std::move(Atom));
+        continue;
+      }
+      // Reduce the closed list
+      if (Frames.size() == 1) {
+        return Fail("unbalanced parentheses");
+      }
+      auto Closed = std::move(Frames.back());
+      Frames.pop_back();
+      Item Result;
+      switch (Closed.Kind) {
+        case FrameKind::Binding: {
+          if (Closed.Items.size() != 2 || Closed.Items[1].Node == nullptr) {
+            return Fail("invalid binding");
+          }
+          Result.Atom = Unquote(Closed.Items[0].Atom);
+          Result.Node = Closed.Items[1].Node;
+          if (this->LetAsReferences) {
+            Result.Node = Ctx->reference(this->Api.newSymbolicExpression(Result.Node, "let " + Result.Atom));
+          }
+        } break;
+        case FrameKind::Bindings: {
+          // The bindings are visible in the body only (and not in each other)
+          vector<string> Names;
+          for (auto& Binding : Closed.Items) {
+            if (Binding.Node == nullptr) {
+              return Fail("invalid binding");
+            }
+            this->Bound[Binding.Atom].push_back(Binding.Node);
+            Names.push_back(Binding.Atom);
+          }
+          this->Scopes.push_back(std::move(Names));
+        } break;
+        case FrameKind::Let: {
+          if (Closed.Items.size() != 3 || Closed.Items[2].Node == nullptr) {
+            return Fail("invalid let");
+          }
+          // Close the scope of the bindings
+          for (auto& Name : this->Scopes.back()) {
+            this->Bound[Name].pop_back();
+          }
+          this->Scopes.pop_back();
+          Result.Node = Closed.Items[2].Node;
+        } break;
+        default: {
+          auto& Items = Closed.Items;
+          if (Items.empty() || Items[0].Node) {
+            return Fail("expected an operator");
+          }
+          if (!Items[0].Indexed && Items[0].Atom == "_") {
+            // Constants '(_ bvVALUE SIZE)' and indexed operators '(_ NAME INDEX...)'
+            if (Items.size() < 3) {
+              return Fail("invalid indexed form");
+            }
+            auto& Name = Items[1].Atom;
+            for (size_t i = 2; i < Items.size(); i++) {
+              Result.Indices.push_back((uint32)stoul(Items[i].Atom));
+            }
+            if (Name.size() > 2 && Name.compare(0, 2, "bv") == 0 && isdigit((unsigned char)Name[2])) {
+              auto& Literal = this->Shared[Name + ":" + Items[2].Atom];
+              if (Literal == nullptr) {
+                Literal = Ctx->bv(uint512(Name.substr(2)), Result.Indices[0]);
+              }
+              Result.Node = Literal;
+            } else {
+              Result.Atom = Name;
+              Result.Indexed = true;
+            }
+          } else {
+            vector<SharedAbstractNode> Args;
+            for (size_t i = 1; i < Items.size(); i++) {
+              if (Items[i].Node == nullptr) {
+                return Fail("unexpected indexed operator: " + Items[i].Atom);
+              }
+              Args.push_back(Items[i].Node);
+            }
+            Result.Node = this->Build(Items[0].Atom, Items[0].Indices, Args);
+            if (Result.Node == nullptr) {
+              return Fail("invalid term");
+            }
+          }
+        } break;
+      }
+      Frames.back().Items.push_back(std::move(Result));
+    }
+    auto& Root = Frames[0].Items[0];
+    if (Root.Node == nullptr) {
+      return Fail("expected a term");
+    }
+    return Root.Node;
+  } catch (const exception& E) {
+    // Triton rejects the ill-sorted terms
+    this->Error = E.what();
+    this->ClearScopes();
+    return nullptr;
+  }
+}
+
+/*
+  Parse a whole script, streaming its commands: the declarations and the definitions are
+  handled, the assertions are passed to the callback and the other commands are skipped.
+  Only the assertion being parsed is ever held in memory.
+*/
+
+bool ExpressionParser::ParseScript(istream& Input, const AssertionCallback& OnAssertion) {
+  FormReader Reader(Input);
+  TokenSource Next = [&](string& Token) {
+    return Reader.NextToken(Token);
+  };
+  string Token;
+  string Name;
+  while (Next(Token)) {
+    if (Token != "(" || !Next(Name)) {
+      this->Error = "expected a command";
+      return false;
+    }
+    try {
+      if (Name == "assert") {
+        auto Assertion = this->ParseTerm(Next);
+        if (Assertion == nullptr) {
+          return false;
+        }
+        if (!Next(Token) || Token != ")") {
+          this->Error = "assert: expected ')'";
+          return false;
+        }
+        if (!OnAssertion(Assertion)) {
+          return true;
+        }
+      } else if (Name == "declare-fun" || Name == "declare-const" || Name == "define-fun") {
+        if (!this->Command(Name, Next)) {
+          return false;
+        }
+      } else {
+        // Skip the other commands
+        int64_t Depth = 1;
+        while (Depth > 0 && Next(Token)) {
+          Depth += (Token == "(") ? 1 : (Token == ")") ? -1 : 0;
+        }
+      }
+    } catch (const exception& E) {
+      this->Error = E.what();
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+  Getters.
+*/
+
+map<string, SharedAbstractNode>& ExpressionParser::GetVariables() {
+  return this->Variables;
+}
+
+const string& ExpressionParser::GetError() const {
+  return this->Error;
+}
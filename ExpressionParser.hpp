@@ -0,0 +1,142 @@
+#ifndef EXPRESSIONPARSER_HPP
+#define EXPRESSIONPARSER_HPP
+
+// std
+#include <unordered_map>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+#include <map>
+
+// triton
+#include <triton/api.hpp>
+
+/*
+  Reader splitting a stream in its top-level S-expressions, or in its tokens (comments
+  are skipped). The stream is read in chunks, so it never needs to fit in memory.
+*/
+
+class FormReader {
+private:
+
+  // Input stream and its buffered chunk
+  std::istream& Input;
+  std::vector<char> Buffer;
+  size_t Position;
+  size_t Size;
+
+  // Number of bytes consumed so far
+  uint64_t BytesRead;
+
+  // Fetch the next character (false at the end of the stream)
+  bool Get(char& C);
+
+  // Look at the next character without consuming it (false at the end of the stream)
+  bool Peek(char& C);
+
+public:
+  // Default constructor
+  FormReader(std::istream& Input, size_t ChunkSize = 1 << 16);
+
+  // Read the next top-level form (false at the end of the stream)
+  bool Next(std::string& Form);
+
+  // Read the next token: a parenthesis, a quoted symbol or an atom (false at the end of the stream)
+  bool NextToken(std::string& Token);
+
+  // Get the number of bytes consumed so far
+  uint64_t GetBytesRead() const;
+};
+
+/*
+  Parser of SMT-LIB2 bitvector terms (as printed by Triton) into the AST context of a
+  Triton API. The variables are introduced by 'declare-fun'/'declare-const' and become
+  symbolic variables aliased with the declared name; the constants introduced by
+  'define-fun' and the 'let' bindings are expanded to their (shared) terms, or become
+  references to symbolic expressions if requested. The structurally identical terms are
+  built only once, so the parsed ASTs are DAGs even when the text isn't.
+*/
+
+class ExpressionParser {
+public:
+  // Source of the tokens of a term (false at the end)
+  using TokenSource = std::function<bool(std::string& Token)>;
+
+  // Callback receiving the assertions of a script (false to stop)
+  using AssertionCallback = std::function<bool(const triton::ast::SharedAbstractNode& Assertion)>;
+
+private:
+
+  // Triton context owning the parsed nodes
+  triton::API& Api;
+
+  // Turn the 'let' bindings into references
+  bool LetAsReferences;
+
+  // Declared variables and defined constants by name, variables by symbolic variable name
+  std::map<std::string, triton::ast::SharedAbstractNode> Declared;
+  std::map<std::string, triton::ast::SharedAbstractNode> Variables;
+
+  // Active 'let' bindings (a stack for each name) and the names bound by each scope
+  std::unordered_map<std::string, std::vector<triton::ast::SharedAbstractNode>> Bound;
+  std::vector<std::vector<std::string>> Scopes;
+
+  // Built terms by structure (cleared when it grows past MaxSharedNodes)
+  std::unordered_map<std::string, triton::ast::SharedAbstractNode> Shared;
+  size_t MaxSharedNodes;
+
+  // Last error
+  std::string Error;
+
+  // Split a text in tokens
+  static std::vector<std::string> Tokenize(const std::string& Text);
+
+  // Build the node of an operator (or fetch the identical one already built)
+  triton::ast::SharedAbstractNode Build(const std::string& Op, const std::vector<triton::uint32>& Indices, const std::vector<triton::ast::SharedAbstractNode>& Args);
+
+  // Build the node of an operator
+  triton::ast::SharedAbstractNode BuildNode(const std::string& Op, const std::vector<triton::uint32>& Indices, const std::vector<triton::ast::SharedAbstractNode>& Args);
+
+  // Build the node of an atom (literal, bound name or declared variable)
+  triton::ast::SharedAbstractNode Atom(const std::string& Token);
+
+  // Remove the 'let' scopes left by an aborted parse
+  void ClearScopes();
+
+  // Read a sort (the size of a bitvector, 0 for Bool)
+  bool Sort(const TokenSource& Next, triton::uint32& Size);
+
+  // Handle a declaration or a definition, reading its tokens after the command name
+  bool Command(const std::string& Name, const TokenSource& Next);
+
+public:
+  // Default constructor
+  ExpressionParser(triton::API& Api, bool LetAsReferences = false, size_t MaxSharedNodes = 1 << 20);
+
+  // Declare a variable from a 'declare-fun'/'declare-const' form, or define a constant from a 'define-fun' form
+  bool Declare(const std::string& Form);
+
+  // Parse a term (nullptr on error, see GetError)
+  triton::ast::SharedAbstractNode Parse(const std::string& Text);
+
+  // Parse exactly one term from a source of tokens (nullptr on error, see GetError)
+  triton::ast::SharedAbstractNode ParseTerm(const TokenSource& Next);
+
+  // Parse a whole script from a stream, passing each assertion to the callback
+  bool ParseScript(std::istream& Input, const AssertionCallback& OnAssertion);
+
+  // Check if a form is a declaration (or a constant definition)
+  static bool IsDeclaration(const std::string& Form);
+
+  // Get the head symbol of a form (empty for atoms)
+  static std::string GetHead(const std::string& Form);
+
+  // Get the declared variables by symbolic variable name (as used by the Translator)
+  std::map<std::string, triton::ast::SharedAbstractNode>& GetVariables();
+
+  // Get the last error
+  const std::string& GetError() const;
+};
+
+#endif
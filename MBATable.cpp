@@ -0,0 +1,83 @@
+#include <MBATable.hpp>
+
+/*
+  Enumerate the bitwise expressions by increasing size (up to 17 nodes, which is enough
+  to cover all the functions of 4 variables).
+*/
+
+MBATable::MBATable(unsigned Variables) : Variables(Variables) {
+  // Number of corners and mask of the truth tables
+  unsigned Corners = 1 << Variables;
+  uint16_t Mask = this->GetMask();
+  unsigned MaxCost = 17;
+  this->Entries.resize(1 << Corners);
+  // Expressions grouped by size
+  std::vector<std::vector<uint16_t>> Levels(MaxCost + 1);
+  auto Insert = [&](uint16_t TruthTable, Operation Op, uint16_t Left, uint16_t Right, unsigned Cost) {
+    auto& Entry = this->Entries[TruthTable & Mask];
+    if (Entry.Cost <= Cost) {
+      return;
+    }
+    Entry.Op = Op;
+    Entry.Left = Left;
+    Entry.Right = Right;
+    Entry.Cost = Cost;
+    Levels[Cost].push_back(TruthTable & Mask);
+  };
+  // The variables are the smallest expressions
+  for (unsigned j = 0; j < Variables; j++) {
+    uint16_t TruthTable = 0;
+    for (unsigned v = 0; v < Corners; v++) {
+      if ((v >> j) & 1) {
+        TruthTable |= 1 << v;
+      }
+    }
+    Insert(TruthTable, Operation::Variable, j, 0, 1);
+  }
+  // Combine the smaller expressions
+  for (unsigned Cost = 2; Cost <= MaxCost; Cost++) {
+    for (auto TruthTable : Levels[Cost - 1]) {
+      Insert(~TruthTable, Operation::Not, TruthTable, 0, Cost);
+    }
+    for (unsigned LeftCost = 1; LeftCost <= (Cost - 1) / 2; LeftCost++) {
+      unsigned RightCost = Cost - 1 - LeftCost;
+      for (auto Left : Levels[LeftCost]) {
+        for (auto Right : Levels[RightCost]) {
+          Insert(Left & Right, Operation::And, Left, Right, Cost);
+          Insert(Left | Right, Operation::Or, Left, Right, Cost);
+          Insert(Left ^ Right, Operation::Xor, Left, Right, Cost);
+        }
+      }
+    }
+  }
+}
+
+/*
+  Get the table for the given number of variables (built on first use).
+*/
+
+const MBATable& MBATable::Get(unsigned Variables) {
+  static std::once_flag Built[MaxVariables + 1];
+  static MBATable* Tables[MaxVariables + 1] = { nullptr };
+  std::call_once(Built[Variables], [Variables]() {
+    Tables[Variables] = new MBATable(Variables);
+  });
+  return *Tables[Variables];
+}
+
+/*
+  Get the entry of a truth table.
+*/
+
+const MBATable::Entry& MBATable::Lookup(uint16_t TruthTable) const {
+  return this->Entries[TruthTable & this->GetMask()];
+}
+
+/*
+  Get the truth table mask.
+*/
+
+uint16_t MBATable::GetMask() const {
+  unsigned Corners = 1 << this->Variables;
+  return (Corners == 16) ? 0xFFFF : ((1 << Corners) - 1);
+}
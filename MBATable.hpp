@@ -0,0 +1,59 @@
+#ifndef MBATABLE_HPP
+#define MBATABLE_HPP
+
+// std
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+/*
+  Table of the minimal expressions (AND, OR, XOR and NOT over the variables) of the
+  bitwise functions of up to 4 variables, indexed by their truth table. The truth
+  table has a bit for each boolean corner of the inputs: bit 'v' holds the value of
+  the function when the variable 'j' is set to the bit 'j' of 'v'.
+
+  The table is built once, enumerating the expressions by increasing size, so the
+  first expression found for a truth table is a minimal one. The functions which
+  need an expression bigger than the enumeration limit are left empty.
+*/
+
+class MBATable {
+public:
+  // Operations of the table entries
+  enum class Operation : uint8_t { None, Variable, Not, And, Or, Xor };
+
+  // Table entry
+  typedef struct Entry {
+    // Operation computing the truth table
+    Operation Op = Operation::None;
+    // Operands (truth tables) or variable index
+    uint16_t Left = 0;
+    uint16_t Right = 0;
+    // Number of nodes of the expression
+    uint8_t Cost = UINT8_MAX;
+  } Entry;
+
+  // Maximum number of variables
+  static const unsigned MaxVariables = 4;
+
+  // Get the table for the given number of variables (built on first use)
+  static const MBATable& Get(unsigned Variables);
+
+  // Get the entry of a truth table (Op is None if no expression is known)
+  const Entry& Lookup(uint16_t TruthTable) const;
+
+  // Get the truth table mask (a bit for each corner)
+  uint16_t GetMask() const;
+
+private:
+  // Build the table for the given number of variables
+  MBATable(unsigned Variables);
+
+  // Number of variables
+  unsigned Variables;
+
+  // Entries indexed by truth table
+  std::vector<Entry> Entries;
+};
+
+#endif
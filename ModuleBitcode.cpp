@@ -0,0 +1,30 @@
+#include <ModuleBitcode.hpp>
+
+// std
+#include <iostream>
+
+/*
+  Serialize a Module to its bitcode.
+*/
+
+std::string SerializeModule(const llvm::Module& Module) {
+  std::string Bitcode;
+  llvm::raw_string_ostream Stream(Bitcode);
+  llvm::WriteBitcodeToFile(Module, Stream);
+  Stream.flush();
+  return Bitcode;
+}
+
+/*
+  Deserialize a Module in the given context.
+*/
+
+std::shared_ptr<llvm::Module> DeserializeModule(const std::string& Bitcode, llvm::LLVMContext& Context) {
+  llvm::MemoryBufferRef Buffer(Bitcode, "TritonAstBitcode");
+  auto Module = llvm::parseBitcodeFile(Buffer, Context);
+  if (!Module) {
+    std::cout << "DeserializeModule: " << llvm::toString(Module.takeError()) << std::endl;
+    return nullptr;
+  }
+  return std::move(*Module);
+}
@@ -0,0 +1,27 @@
+#ifndef MODULEBITCODE_HPP
+#define MODULEBITCODE_HPP
+
+// std
+#include <memory>
+#include <string>
+
+// llvm
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+/*
+  Helpers to move LLVM-IR Modules across LLVMContext(s) using their bitcode, which
+  doesn't depend on any context and can be stored or shared between threads.
+*/
+
+// Serialize a Module to its bitcode
+std::string SerializeModule(const llvm::Module& Module);
+
+// Deserialize a Module in the given context
+std::shared_ptr<llvm::Module> DeserializeModule(const std::string& Bitcode, llvm::LLVMContext& Context);
+
+#endif
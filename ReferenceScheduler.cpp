@@ -0,0 +1,234 @@
+#include <ReferenceScheduler.hpp>
+
+/*
+  Default constructor:
+  - we need the Triton context owning the ASTs
+  - the options configure the workers
+*/
+
+ReferenceScheduler::ReferenceScheduler(API& Api, const ReferenceSchedulerOptions& Options) : Api(Api), Options(Options), Failed(0) {
+  // The cached Modules load the variables as globals
+  this->Options.Translation.VariablesAsArguments = false;
+  // The workers can't create Triton nodes concurrently
+  this->Options.Translation.TruthTableLookup = false;
+  this->Options.Translation.SizeAwareReferences = false;
+}
+
+/*
+  Build the DAG of the references reachable from the roots. The cached references are
+  leaves: they aren't explored, the workers only need their bitcode. A cached reference
+  may load the references kept opaque by an older translation: their nodes are created
+  here, on the caller's thread, and registered for the workers linking it. The tasks
+  are then ordered so that each one follows the references it depends on.
+*/
+
+void ReferenceScheduler::BuildGraph(const vector<SharedAbstractNode>& Roots, const map<ExpKey, shared_ptr<llvm::Module>>& Cache) {
+  // Forget the previous schedule
+  this->Tasks.clear();
+  this->Order.clear();
+  this->Bitcode.clear();
+  this->OpaqueReferences.clear();
+  auto Ctx = this->Api.getAstContext();
+  // ASTs still to be explored, with their expression (nullptr for the roots)
+  vector<pair<SharedAbstractNode, SharedExpression>> Pending;
+  for (auto& Root : Roots) {
+    Pending.push_back({ Root, nullptr });
+  }
+  while (!Pending.empty()) {
+    auto Top = Pending.back();
+    Pending.pop_back();
+    // Collect the references of the AST (without entering them)
+    set<ExpKey> Dependencies;
+    set<AbstractNode*> Visited = { Top.first.get() };
+    vector<AbstractNode*> Worklist = { Top.first.get() };
+    while (!Worklist.empty()) {
+      auto* Node = Worklist.back();
+      Worklist.pop_back();
+      // The constant sub-trees are folded while lifting
+      if (!Node->isSymbolized()) {
+        continue;
+      }
+      if (Node->getType() == ast_e::REFERENCE_NODE) {
+        const auto& Expression = static_cast<ReferenceNode*>(Node)->getSymbolicExpression();
+        auto Id = Expression->getId();
+        Dependencies.insert(Id);
+        if (Cache.find(Id) != Cache.end()) {
+          // Already lifted, the workers only need its bitcode
+          if (this->Bitcode.find(Id) == this->Bitcode.end()) {
+            auto& Module = *Cache.at(Id);
+            this->Bitcode[Id] = SerializeModule(Module);
+            for (auto& GVar : Module.globals()) {
+              StringRef VarName = GVar.getName();
+              if (VarName.startswith("OpaqueRef_")) {
+                auto OpaqueId = stoull(VarName.substr(VarName.rfind('_') + 1).str());
+                auto Reference = Ctx->reference(this->Api.getSymbolicExpression(OpaqueId));
+                Translator::RegisterFakeVariable(this->Api, VarName.str(), Reference);
+                this->OpaqueReferences.push_back(Reference);
+              }
+            }
+          }
+        } else if (this->Tasks.find(Id) == this->Tasks.end()) {
+          // Explore the referenced AST once
+          this->Tasks[Id].Expression = Expression;
+          Pending.push_back({ Expression->getAst(), Expression });
+        }
+        continue;
+      }
+      for (auto& Child : Node->getChildren()) {
+        if (Visited.insert(Child.get()).second) {
+          Worklist.push_back(Child.get());
+        }
+      }
+    }
+    // Link the expression to its dependencies
+    if (Top.second) {
+      auto Id = Top.second->getId();
+      auto& Task = this->Tasks[Id];
+      for (auto Dependency : Dependencies) {
+        Task.Dependencies.push_back(Dependency);
+        auto Other = this->Tasks.find(Dependency);
+        if (Other != this->Tasks.end()) {
+          Other->second.Dependents.push_back(Id);
+          Task.Pending++;
+        }
+      }
+    }
+  }
+  // Order the tasks so that each one follows its dependencies
+  map<ExpKey, size_t> Missing;
+  for (auto& Task : this->Tasks) {
+    Missing[Task.first] = Task.second.Pending;
+    if (Task.second.Pending == 0) {
+      this->Order.push_back(Task.first);
+    }
+  }
+  for (size_t i = 0; i < this->Order.size(); i++) {
+    for (auto Dependent : this->Tasks[this->Order[i]].Dependents) {
+      if (--Missing[Dependent] == 0) {
+        this->Order.push_back(Dependent);
+      }
+    }
+  }
+}
+
+/*
+  Lift the ready references until the schedule is done. Each worker has its own context,
+  Translator and cache; the Modules of the dependencies lifted by the other workers are
+  fetched from their bitcode, and a lifted reference releases the references waiting for
+  it. A reference whose lifting fails releases them too, they resolve it on their own.
+*/
+
+void ReferenceScheduler::Work(BoundedQueue<ExpKey>& Ready, size_t& Remaining, mutex& StateMutex) {
+  // Context of the worker (declared first, so it's destroyed last)
+  LLVMContext Context;
+  Translator Worker(Context, this->Api, this->Options.Translation);
+  map<ExpKey, shared_ptr<llvm::Module>> Cache;
+  ExpKey Id;
+  while (Ready.Pop(Id)) {
+    // The graph isn't changed while working, only the pending counters
+    auto& Task = this->Tasks.find(Id)->second;
+    // Fetch the Modules of the dependencies
+    for (auto Dependency : Task.Dependencies) {
+      if (Cache.find(Dependency) != Cache.end()) {
+        continue;
+      }
+      string Code;
+      {
+        lock_guard<mutex> Lock(this->BitcodeMutex);
+        auto Entry = this->Bitcode.find(Dependency);
+        if (Entry != this->Bitcode.end()) {
+          Code = Entry->second;
+        }
+      }
+      if (!Code.empty()) {
+        if (auto Module = DeserializeModule(Code, Context)) {
+          Cache[Dependency] = Module;
+        }
+      }
+    }
+    // Lift and optimize the referenced AST
+    auto Module = Worker.TritonAstToLLVMIR(Task.Expression->getAst(), Cache);
+    if (Module) {
+      Cache[Id] = Module;
+      auto Code = SerializeModule(*Module);
+      lock_guard<mutex> Lock(this->BitcodeMutex);
+      this->Bitcode[Id] = std::move(Code);
+    }
+    // Release the references waiting for it
+    lock_guard<mutex> Lock(StateMutex);
+    if (Module == nullptr) {
+      this->Failed++;
+    }
+    for (auto Dependent : Task.Dependents) {
+      if (--this->Tasks.find(Dependent)->second.Pending == 0) {
+        Ready.Push(Dependent);
+      }
+    }
+    // Stop all the workers after the last reference
+    if (--Remaining == 0) {
+      Ready.Close();
+    }
+  }
+}
+
+/*
+  Lift the references reachable from the roots (and not cached yet) with the workers,
+  then publish them in the cache of the given context in dependency order. The roots
+  themselves aren't lifted: the following translations find their references cached.
+*/
+
+size_t ReferenceScheduler::Schedule(const vector<SharedAbstractNode>& Roots, map<ExpKey, shared_ptr<llvm::Module>>& Cache, LLVMContext& Context) {
+  // Build the reference DAG
+  this->BuildGraph(Roots, Cache);
+  this->Failed = 0;
+  if (this->Tasks.empty()) {
+    this->Bitcode.clear();
+    this->OpaqueReferences.clear();
+    return 0;
+  }
+  // Queue the references without dependencies (the queue never blocks the workers)
+  BoundedQueue<ExpKey> Ready(this->Tasks.size());
+  for (auto& Task : this->Tasks) {
+    if (Task.second.Pending == 0) {
+      Ready.Push(Task.first);
+    }
+  }
+  size_t Remaining = this->Tasks.size();
+  mutex StateMutex;
+  // Start the workers
+  size_t Threads = this->Options.Threads ? this->Options.Threads : std::max(1u, thread::hardware_concurrency());
+  Threads = std::min(Threads, this->Tasks.size());
+  vector<thread> Workers;
+  for (size_t i = 0; i < Threads; i++) {
+    Workers.emplace_back(&ReferenceScheduler::Work, this, std::ref(Ready), std::ref(Remaining), std::ref(StateMutex));
+  }
+  for (auto& Worker : Workers) {
+    Worker.join();
+  }
+  // Publish the lifted references in dependency order
+  size_t Published = 0;
+  for (auto Id : this->Order) {
+    auto Entry = this->Bitcode.find(Id);
+    if (Entry == this->Bitcode.end()) {
+      continue;
+    }
+    if (auto Module = DeserializeModule(Entry->second, Context)) {
+      Cache[Id] = Module;
+      Published++;
+    }
+  }
+  // Release the schedule
+  this->Tasks.clear();
+  this->Order.clear();
+  this->Bitcode.clear();
+  this->OpaqueReferences.clear();
+  return Published;
+}
+
+/*
+  Get the number of references whose lifting failed in the last schedule.
+*/
+
+size_t ReferenceScheduler::GetFailed() const {
+  return this->Failed;
+}
@@ -0,0 +1,82 @@
+#ifndef REFERENCESCHEDULER_HPP
+#define REFERENCESCHEDULER_HPP
+
+// translator
+#include <Translator.hpp>
+#include <ModuleBitcode.hpp>
+#include <BoundedQueue.hpp>
+
+// strutures
+typedef struct ReferenceSchedulerOptions {
+  // Number of worker threads (0 = one per core)
+  unsigned Threads = 0;
+  // Options of the workers' Translator(s)
+  TranslatorOptions Translation;
+} ReferenceSchedulerOptions;
+
+typedef struct ReferenceTask {
+  // Referenced expression
+  SharedExpression Expression;
+  // Expressions referenced by its AST (not cached yet)
+  vector<ExpKey> Dependencies;
+  // Expressions referencing it
+  vector<ExpKey> Dependents;
+  // Dependencies not lifted yet
+  size_t Pending = 0;
+} ReferenceTask;
+
+/*
+  Scheduler lifting the referenced expressions of some ASTs before the ASTs themselves.
+  The references form a DAG, which is built first; then each reference is lifted and
+  optimized by a worker thread, with its own context, as soon as all the references it
+  depends on are done, so the independent ones are handled concurrently. The workers
+  exchange the lifted Modules as bitcode, and the results are published in the cache
+  of the caller's context in dependency order. The workers only read the Triton ASTs,
+  so the options creating new nodes while lifting are disabled, and the nodes of the
+  opaque references loaded by the cached Modules are created before they start.
+*/
+
+class ReferenceScheduler {
+private:
+
+  // Triton context owning the ASTs
+  API& Api;
+
+  // Scheduling options
+  ReferenceSchedulerOptions Options;
+
+  // Tasks of the current schedule (by expression ID) in dependency order
+  map<ExpKey, ReferenceTask> Tasks;
+  vector<ExpKey> Order;
+
+  // Bitcode of the lifted references, and of the ones already cached by the caller
+  map<ExpKey, string> Bitcode;
+  mutex BitcodeMutex;
+
+  // Nodes of the opaque references loaded by the cached Modules (alive while scheduling)
+  vector<SharedAbstractNode> OpaqueReferences;
+
+  // Number of references whose lifting failed in the last schedule
+  size_t Failed;
+
+  // Build the DAG of the references reachable from the roots and not cached yet
+  void BuildGraph(const vector<SharedAbstractNode>& Roots, const map<ExpKey, shared_ptr<llvm::Module>>& Cache);
+
+  // Lift the ready references until the schedule is done
+  void Work(BoundedQueue<ExpKey>& Ready, size_t& Remaining, mutex& StateMutex);
+
+public:
+  // Default constructor
+  ReferenceScheduler(API& Api, const ReferenceSchedulerOptions& Options = ReferenceSchedulerOptions());
+
+  // Default destructor
+  ~ReferenceScheduler() {};
+
+  // Lift the references reachable from the roots into the cache of a context (returns the number of published Modules)
+  size_t Schedule(const vector<SharedAbstractNode>& Roots, map<ExpKey, shared_ptr<llvm::Module>>& Cache, LLVMContext& Context);
+
+  // Get the number of references whose lifting failed in the last schedule
+  size_t GetFailed() const;
+};
+
+#endif
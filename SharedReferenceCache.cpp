@@ -0,0 +1,166 @@
+#include <SharedReferenceCache.hpp>
+
+using namespace std;
+
+/*
+  Default constructor:
+  - the number of shards bounds the contention between the threads
+*/
+
+SharedReferenceCache::SharedReferenceCache(size_t ShardCount) : Hits(0), Misses(0), Waits(0) {
+  for (size_t i = 0; i < (ShardCount ? ShardCount : 1); i++) {
+    this->Shards.push_back(make_unique<Shard>());
+  }
+}
+
+/*
+  Get the shard of a reference (the expression IDs are sequential, so they spread evenly
+  within each Triton context).
+*/
+
+SharedReferenceCache::Shard& SharedReferenceCache::GetShard(const SharedKey& Key) {
+  return *this->Shards[SharedKeyHash()(Key) % this->Shards.size()];
+}
+
+/*
+  Get the bitcode of a reference, holding the shard lock only for the lookup.
+*/
+
+shared_ptr<const string> SharedReferenceCache::Find(const triton::API& Api, triton::usize Id) {
+  SharedKey Key{ &Api, Id };
+  auto& S = this->GetShard(Key);
+  shared_lock<shared_mutex> Lock(S.Mutex);
+  auto Entry = S.Entries.find(Key);
+  if (Entry == S.Entries.end()) {
+    this->Misses++;
+    return nullptr;
+  }
+  this->Hits++;
+  return Entry->second;
+}
+
+/*
+  Claim a reference to lift it. If another thread is lifting it, wait until it's published
+  (the caller fetches it) or abandoned (the caller claims it), giving up at the deadline
+  or once cancelled; the flag is polled, nobody signals it. A thread owning the claim
+  already keeps it.
+*/
+
+ClaimOutcome SharedReferenceCache::Claim(const triton::API& Api, triton::usize Id, chrono::steady_clock::time_point Deadline, const atomic<bool>* Cancelled) {
+  SharedKey Key{ &Api, Id };
+  auto& S = this->GetShard(Key);
+  unique_lock<shared_mutex> Lock(S.Mutex);
+  bool Waited = false;
+  while (true) {
+    // Already published
+    if (S.Entries.find(Key) != S.Entries.end()) {
+      return ClaimOutcome::Published;
+    }
+    // Free to be claimed (or already ours)
+    auto Owner = S.Claimed.find(Key);
+    if (Owner == S.Claimed.end()) {
+      S.Claimed[Key] = this_thread::get_id();
+      return ClaimOutcome::Claimed;
+    }
+    if (Owner->second == this_thread::get_id()) {
+      return ClaimOutcome::Claimed;
+    }
+    // Stop waiting at the deadline or once cancelled
+    auto Now = chrono::steady_clock::now();
+    if ((Cancelled && Cancelled->load()) || Now >= Deadline) {
+      return ClaimOutcome::Expired;
+    }
+    // Wait for the other thread
+    if (!Waited) {
+      this->Waits++;
+      Waited = true;
+    }
+    if (Cancelled) {
+      S.Released.wait_until(Lock, (Deadline - Now > chrono::milliseconds(10)) ? Now + chrono::milliseconds(10) : Deadline);
+    } else if (Deadline != chrono::steady_clock::time_point::max()) {
+      S.Released.wait_until(Lock, Deadline);
+    } else {
+      S.Released.wait(Lock);
+    }
+  }
+}
+
+/*
+  Publish the bitcode of a reference and wake up the threads waiting for it.
+*/
+
+void SharedReferenceCache::Publish(const triton::API& Api, triton::usize Id, string Bitcode) {
+  SharedKey Key{ &Api, Id };
+  auto Entry = make_shared<const string>(std::move(Bitcode));
+  auto& S = this->GetShard(Key);
+  {
+    unique_lock<shared_mutex> Lock(S.Mutex);
+    S.Entries.emplace(Key, Entry);
+    S.Claimed.erase(Key);
+  }
+  S.Released.notify_all();
+}
+
+/*
+  Release the claim of a reference which wasn't lifted, so a waiting thread can lift it.
+*/
+
+void SharedReferenceCache::Abandon(const triton::API& Api, triton::usize Id) {
+  SharedKey Key{ &Api, Id };
+  auto& S = this->GetShard(Key);
+  {
+    unique_lock<shared_mutex> Lock(S.Mutex);
+    S.Claimed.erase(Key);
+  }
+  S.Released.notify_all();
+}
+
+/*
+  Get the number of published references.
+*/
+
+size_t SharedReferenceCache::Size() {
+  size_t Count = 0;
+  for (auto& S : this->Shards) {
+    shared_lock<shared_mutex> Lock(S->Mutex);
+    Count += S->Entries.size();
+  }
+  return Count;
+}
+
+/*
+  Remove all the published references, or the ones of a Triton context (the claims are
+  left to their owners).
+*/
+
+void SharedReferenceCache::Clear() {
+  for (auto& S : this->Shards) {
+    unique_lock<shared_mutex> Lock(S->Mutex);
+    S->Entries.clear();
+  }
+}
+
+void SharedReferenceCache::Clear(const triton::API& Api) {
+  for (auto& S : this->Shards) {
+    unique_lock<shared_mutex> Lock(S->Mutex);
+    for (auto It = S->Entries.begin(); It != S->Entries.end();) {
+      It = (It->first.Api == &Api) ? S->Entries.erase(It) : std::next(It);
+    }
+  }
+}
+
+/*
+  Get the lookup statistics.
+*/
+
+uint64_t SharedReferenceCache::GetHits() const {
+  return this->Hits;
+}
+
+uint64_t SharedReferenceCache::GetMisses() const {
+  return this->Misses;
+}
+
+uint64_t SharedReferenceCache::GetWaits() const {
+  return this->Waits;
+}
@@ -0,0 +1,117 @@
+#ifndef SHAREDREFERENCECACHE_HPP
+#define SHAREDREFERENCECACHE_HPP
+
+// std
+#include <condition_variable>
+#include <unordered_map>
+#include <chrono>
+#include <shared_mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+// triton
+#include <triton/api.hpp>
+
+/*
+  Cache of the lifted references shared by the Translator(s) of many threads. The
+  entries are the bitcode of the optimized Modules, so they don't depend on any
+  LLVMContext: each Translator deserializes them in its own context. The expression IDs
+  are only unique within a Triton context, so the entries are keyed by the API and the
+  ID (the entries of a destroyed API must be cleared before another one takes its
+  address). They're split in shards, each one with its own lock, so the lookups of
+  different threads only contend on the same shard, and never with each other.
+
+  A Translator claims a reference before lifting it: the other threads asking for the
+  same reference wait for it to be published (or abandoned), instead of lifting it too.
+  The wait gives up at the deadline, or once the cancellation flag is set.
+*/
+
+// Outcome of a claim
+enum class ClaimOutcome {
+  // Claimed by the caller, who lifts it
+  Claimed,
+  // Published by another thread
+  Published,
+  // The deadline passed, or the caller was cancelled, while waiting
+  Expired
+};
+
+typedef struct SharedKey {
+  // Triton context of the expression
+  const triton::API* Api;
+  // Expression ID
+  triton::usize Id;
+  bool operator==(const SharedKey& Other) const {
+    return this->Api == Other.Api && this->Id == Other.Id;
+  }
+} SharedKey;
+
+typedef struct SharedKeyHash {
+  size_t operator()(const SharedKey& Key) const {
+    return std::hash<triton::usize>()(Key.Id) ^ (std::hash<const void*>()(Key.Api) << 1);
+  }
+} SharedKeyHash;
+
+class SharedReferenceCache {
+private:
+
+  typedef struct Shard {
+    // Lock of the shard (shared by the lookups)
+    std::shared_mutex Mutex;
+    // Bitcode of the published references
+    std::unordered_map<SharedKey, std::shared_ptr<const std::string>, SharedKeyHash> Entries;
+    // References being lifted, by the claiming thread
+    std::unordered_map<SharedKey, std::thread::id, SharedKeyHash> Claimed;
+    // Signaled when a claimed reference is published or abandoned
+    std::condition_variable_any Released;
+  } Shard;
+
+  // Shards of the cache
+  std::vector<std::unique_ptr<Shard>> Shards;
+
+  // Lookup statistics
+  std::atomic<uint64_t> Hits;
+  std::atomic<uint64_t> Misses;
+  std::atomic<uint64_t> Waits;
+
+  // Get the shard of a reference
+  Shard& GetShard(const SharedKey& Key);
+
+public:
+  // Default constructor
+  SharedReferenceCache(size_t ShardCount = 64);
+
+  // Default destructor
+  ~SharedReferenceCache() {};
+
+  // Get the bitcode of a reference (nullptr if not published)
+  std::shared_ptr<const std::string> Find(const triton::API& Api, triton::usize Id);
+
+  // Claim a reference to lift it, possibly after waiting for another thread (until the deadline or the cancellation)
+  ClaimOutcome Claim(const triton::API& Api, triton::usize Id, std::chrono::steady_clock::time_point Deadline = std::chrono::steady_clock::time_point::max(), const std::atomic<bool>* Cancelled = nullptr);
+
+  // Publish the bitcode of a reference, releasing its claim (the first published bitcode is kept)
+  void Publish(const triton::API& Api, triton::usize Id, std::string Bitcode);
+
+  // Release the claim of a reference which wasn't lifted
+  void Abandon(const triton::API& Api, triton::usize Id);
+
+  // Get the number of published references
+  size_t Size();
+
+  // Remove all the published references
+  void Clear();
+
+  // Remove the published references of a Triton context (e.g. before destroying it)
+  void Clear(const triton::API& Api);
+
+  // Get the lookup statistics
+  uint64_t GetHits() const;
+  uint64_t GetMisses() const;
+  uint64_t GetWaits() const;
+};
+
+#endif
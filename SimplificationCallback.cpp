@@ -0,0 +1,158 @@
+#include <SimplificationCallback.hpp>
+
+/*
+  Default constructor:
+  - we need the Triton context to register the callback and to build the Translator(s)
+  - the options configure the size gate, the limits and the pool
+*/
+
+SimplificationCallback::SimplificationCallback(API& Api, const SimplificationCallbackOptions& Options) :
+  Api(Api), Options(Options), Pool(Api, Options.Pool), KnownVariables(0), Active(false), Registered(false) {}
+
+/*
+  Default destructor: the API must not call back a destroyed object.
+*/
+
+SimplificationCallback::~SimplificationCallback() {
+  this->Unregister();
+}
+
+/*
+  Get the Triton callback bound to this object (the same identity every time, so it
+  can be removed).
+*/
+
+triton::callbacks::symbolicSimplificationCallback SimplificationCallback::GetCallback() {
+  auto Callback = [this](API& Api, const SharedAbstractNode& Node) {
+    return this->Simplify(Api, Node);
+  };
+  return triton::callbacks::symbolicSimplificationCallback(Callback, this);
+}
+
+/*
+  Register and remove the callback.
+*/
+
+void SimplificationCallback::Register() {
+  if (!this->Registered) {
+    this->Api.addCallback(this->GetCallback());
+    this->Registered = true;
+  }
+}
+
+void SimplificationCallback::Unregister() {
+  if (this->Registered) {
+    this->Api.removeCallback(this->GetCallback());
+    this->Registered = false;
+  }
+}
+
+/*
+  Count the distinct nodes of an AST, stopping as soon as Limit is reached. Unless
+  FollowReferences is set the references count as one node (their expressions are
+  lifted from the cache), otherwise the referenced ASTs are counted too.
+*/
+
+uint64_t SimplificationCallback::CountNodes(const SharedAbstractNode& Node, uint64_t Limit, bool FollowReferences) const {
+  uint64_t Count = 0;
+  set<AbstractNode*> Visited;
+  vector<AbstractNode*> Worklist = { Node.get() };
+  while (!Worklist.empty() && Count < Limit) {
+    auto* Curr = Worklist.back();
+    Worklist.pop_back();
+    if (!Visited.insert(Curr).second) {
+      continue;
+    }
+    Count++;
+    if (Curr->getType() != ast_e::REFERENCE_NODE) {
+      for (auto& Child : Curr->getChildren()) {
+        Worklist.push_back(Child.get());
+      }
+    } else if (FollowReferences) {
+      Worklist.push_back(static_cast<ReferenceNode*>(Curr)->getSymbolicExpression()->getAst().get());
+    }
+  }
+  return Count;
+}
+
+/*
+  Add the variable nodes of the symbolic variables created since the last call (the
+  variables are never removed during an emulation, so counting them is enough).
+*/
+
+void SimplificationCallback::RefreshVariables() {
+  auto SymVars = this->Api.getSymbolicVariables();
+  if (SymVars.size() == this->KnownVariables) {
+    return;
+  }
+  auto Ctx = this->Api.getAstContext();
+  for (auto& Entry : SymVars) {
+    auto& Name = Entry.second->getName();
+    if (this->Variables.find(Name) == this->Variables.end()) {
+      this->Variables[Name] = Ctx->variable(Entry.second);
+    }
+  }
+  this->KnownVariables = SymVars.size();
+}
+
+/*
+  Body of the callback: simplify the ASTs passing the size gate and keep the result only
+  if it's smaller. The translation itself may create symbolic expressions, which invoke
+  the callback again: those are returned as they are.
+*/
+
+SharedAbstractNode SimplificationCallback::Simplify(API&, const SharedAbstractNode& Node) {
+  this->Statistics.Calls++;
+  // Don't recurse into our own expressions
+  if (this->Active) {
+    this->Statistics.Reentrant++;
+    return Node;
+  }
+  // Skip the ASTs too small to pay off the translation
+  if (this->CountNodes(Node, this->Options.MinNodes) < this->Options.MinNodes) {
+    this->Statistics.Skipped++;
+    return Node;
+  }
+  // Simplify within the limits
+  TranslationLimits Limits;
+  if (this->Options.Timeout) {
+    Limits.Deadline = chrono::steady_clock::now() + chrono::milliseconds(this->Options.Timeout);
+  }
+  Limits.MaxNodes = this->Options.MaxNodes;
+  Limits.MaxInstructions = this->Options.MaxInstructions;
+  SharedAbstractNode Result;
+  TranslationStatus Status = TranslationStatus::Failed;
+  this->Active = true;
+  try {
+    this->RefreshVariables();
+    Status = this->Pool.Simplify(Node, this->Variables, Result, Limits, this->Options.MaxDepth);
+  } catch (const exception& E) {
+    cout << "SimplificationCallback: " << E.what() << endl;
+  }
+  this->Active = false;
+  if (Status != TranslationStatus::Success || Result == nullptr) {
+    this->Statistics.Failed++;
+    return Node;
+  }
+  // Keep the original AST unless the result is smaller (the result has the references
+  // expanded, so it's compared with the expanded size of the original AST)
+  auto Size = this->CountNodes(Node, UINT64_MAX, true);
+  if (this->CountNodes(Result, Size, true) >= Size) {
+    this->Statistics.Unchanged++;
+    return Node;
+  }
+  this->Statistics.Simplified++;
+  return Result;
+}
+
+/*
+  Getters.
+*/
+
+const SimplificationStatistics& SimplificationCallback::GetStatistics() const {
+  return this->Statistics;
+}
+
+ContextPool& SimplificationCallback::GetPool() {
+  return this->Pool;
+}
@@ -0,0 +1,115 @@
+#ifndef SIMPLIFICATIONCALLBACK_HPP
+#define SIMPLIFICATIONCALLBACK_HPP
+
+// translator
+#include <ContextPool.hpp>
+
+// strutures
+typedef struct SimplificationCallbackOptions {
+  // Simplify only the ASTs with at least this many nodes (a reference counts as one)
+  uint64_t MinNodes = 32;
+  // Maximum depth of the lifted ASTs
+  ssize_t MaxDepth = -1;
+  // Limits of each simplification (0 = unlimited)
+  uint64_t Timeout = 0;
+  uint64_t MaxNodes = 0;
+  uint64_t MaxInstructions = 0;
+  // Options of the pooled context(s)
+  ContextPoolOptions Pool;
+} SimplificationCallbackOptions;
+
+typedef struct SimplificationStatistics {
+  // Number of invocations of the callback
+  uint64_t Calls = 0;
+  // Invocations while already simplifying (left alone)
+  uint64_t Reentrant = 0;
+  // ASTs below the size gate
+  uint64_t Skipped = 0;
+  // ASTs replaced by a smaller one
+  uint64_t Simplified = 0;
+  // ASTs whose translation wasn't smaller
+  uint64_t Unchanged = 0;
+  // ASTs whose translation failed or hit a limit
+  uint64_t Failed = 0;
+  // Print the statistics
+  void dump() {
+    cout << "{ Calls = " << dec << this->Calls
+         << ", Reentrant = " << dec << this->Reentrant
+         << ", Skipped = " << dec << this->Skipped
+         << ", Simplified = " << dec << this->Simplified
+         << ", Unchanged = " << dec << this->Unchanged
+         << ", Failed = " << dec << this->Failed
+         << " }" << endl;
+  }
+} SimplificationStatistics;
+
+/*
+  Adapter registering the translation as a SYMBOLIC_SIMPLIFICATION callback of a Triton
+  API, so the symbolic expressions are simplified as they are created during the
+  emulation. The references are lifted once and then reused from the cache of the pool,
+  so each new expression only costs its new nodes. The callback only fires on ASTs
+  large enough to pay off the translation, and keeps the result only when it's smaller.
+*/
+
+class SimplificationCallback {
+private:
+
+  // Triton context the callback is registered on
+  API& Api;
+
+  // Options of the callback
+  SimplificationCallbackOptions Options;
+
+  // Context(s), Translator and reference cache
+  ContextPool Pool;
+
+  // Variable nodes by symbolic variable name, and the number of variables seen
+  map<string, SharedAbstractNode> Variables;
+  size_t KnownVariables;
+
+  // Set while simplifying (the expressions created meanwhile are left alone)
+  bool Active;
+
+  // The callback is registered on the API
+  bool Registered;
+
+  // Outcome of the invocations
+  SimplificationStatistics Statistics;
+
+  // Count the nodes of an AST, stopping at Limit (a reference counts as one unless followed)
+  uint64_t CountNodes(const SharedAbstractNode& Node, uint64_t Limit, bool FollowReferences = false) const;
+
+  // Add the symbolic variables created since the last simplification
+  void RefreshVariables();
+
+  // Get the Triton callback bound to this object
+  triton::callbacks::symbolicSimplificationCallback GetCallback();
+
+public:
+  // Default constructor
+  SimplificationCallback(API& Api, const SimplificationCallbackOptions& Options = SimplificationCallbackOptions());
+
+  // Default destructor (unregisters the callback)
+  ~SimplificationCallback();
+
+  // The callback is bound to this object
+  SimplificationCallback(const SimplificationCallback&) = delete;
+  SimplificationCallback& operator=(const SimplificationCallback&) = delete;
+
+  // Register the callback on the API
+  void Register();
+
+  // Remove the callback from the API
+  void Unregister();
+
+  // Simplify an AST (the callback body, Node is returned when not worth it)
+  SharedAbstractNode Simplify(API& Api, const SharedAbstractNode& Node);
+
+  // Get the outcome of the invocations
+  const SimplificationStatistics& GetStatistics() const;
+
+  // Get the pool of the translations
+  ContextPool& GetPool();
+};
+
+#endif
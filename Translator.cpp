@@ -1,12 +1,201 @@
 #include <Translator.hpp>
+#include <SharedReferenceCache.hpp>
+#include <ModuleBitcode.hpp>
+
+/*
+  Thrown by LiftInstructionsDFS on a value it can't lift, unwinding to the entry point.
+*/
+
+typedef struct UnsupportedValue {} UnsupportedValue;
+
+/*
+  Sub-trees cut as fake variables by all the Translator(s), by Triton context and name
+  (the opaque references are only named after their expression ID, which is unique per
+  context). A cached reference keeps the fake variables of the translation which lifted
+  it, so they're looked up again when it's linked (the sub-trees are owned by the
+  referenced expressions).
+*/
+
+static mutex CutNodesMutex;
+static map<pair<const API*, string>, weak_ptr<AbstractNode>> CutNodes;
+static size_t CutNodesPruneAt = 1024;
+static atomic<uint64_t> NextFakeIndex(0);
+
+void Translator::RegisterFakeVariable(const API& Api, const string& Name, const SharedAbstractNode& Node) {
+  lock_guard<mutex> Lock(CutNodesMutex);
+  // Drop the sub-trees released meanwhile
+  if (CutNodes.size() >= CutNodesPruneAt) {
+    for (auto It = CutNodes.begin(); It != CutNodes.end();) {
+      It = It->second.expired() ? CutNodes.erase(It) : std::next(It);
+    }
+    CutNodesPruneAt = 2 * CutNodes.size() + 1024;
+  }
+  CutNodes[{ &Api, Name }] = Node;
+}
+
+static SharedAbstractNode FindCutNode(const API& Api, const string& Name) {
+  lock_guard<mutex> Lock(CutNodesMutex);
+  auto Known = CutNodes.find({ &Api, Name });
+  return (Known != CutNodes.end()) ? Known->second.lock() : nullptr;
+}
 
 /*
   Default contructor:
   - we need the LLVM context to access the cached LLVM-IR Modules
   - we need the Triton context to access the AstContext and the symbolic variables
+  - the options select the optional behaviours of the translation
+*/
+
+Translator::Translator(LLVMContext& Context, API& Api, const TranslatorOptions& Options) : Context(Context), Api(Api), Options(Options) {}
+
+/*
+  Get and set the translation options.
+*/
+
+const TranslatorOptions& Translator::GetOptions() const {
+  return this->Options;
+}
+
+void Translator::SetOptions(const TranslatorOptions& Options) {
+  this->Options = Options;
+}
+
+uint32_t Translator::GetOptimizationIterations() const {
+  return this->OptimizationIterations;
+}
+
+void Translator::SetLimits(const TranslationLimits& Limits) {
+  this->Limits = Limits;
+}
+
+void Translator::SetSharedCache(SharedReferenceCache* Cache) {
+  this->SharedCache = Cache;
+}
+
+TranslationStatus Translator::GetStatus() const {
+  return this->Status;
+}
+
+const char* Translator::GetStatusName(TranslationStatus Status) {
+  switch (Status) {
+    case TranslationStatus::Success: return "success";
+    case TranslationStatus::TimedOut: return "timed out";
+    case TranslationStatus::NodeBudgetExceeded: return "node budget exceeded";
+    case TranslationStatus::InstructionBudgetExceeded: return "instruction budget exceeded";
+    case TranslationStatus::Unsupported: return "unsupported";
+    case TranslationStatus::Cancelled: return "cancelled";
+    default: return "failed";
+  }
+}
+
+const map<string, SharedAbstractNode>& Translator::GetFakeVariables() const {
+  return this->FakeVars;
+}
+
+uint64_t Translator::GetLiftedInstructions() const {
+  return this->LiftedInstructions;
+}
+
+/*
+  Check the limits of the current translation, recording the first one reached.
+*/
+
+bool Translator::CheckLimits(uint64_t Instructions) {
+  if (this->Status != TranslationStatus::Success) {
+    return false;
+  }
+  if (this->Limits.MaxNodes && this->VisitedNodes > this->Limits.MaxNodes) {
+    this->Status = TranslationStatus::NodeBudgetExceeded;
+  } else if (this->Limits.MaxInstructions && Instructions > this->Limits.MaxInstructions) {
+    this->Status = TranslationStatus::InstructionBudgetExceeded;
+  } else if (chrono::steady_clock::now() >= this->Limits.Deadline) {
+    this->Status = TranslationStatus::TimedOut;
+  } else if (this->Limits.Cancelled && this->Limits.Cancelled->load()) {
+    this->Status = TranslationStatus::Cancelled;
+  }
+  return this->Status == TranslationStatus::Success;
+}
+
+namespace {
+
+/*
+  Pass checking the translation limits between the optimizations. When a limit is reached
+  the body of the function is replaced by 'ret undef', so the rest of the pipeline has
+  nothing left to do and returns quickly.
 */
 
-Translator::Translator(LLVMContext& Context, API& Api) : Context(Context), Api(Api) {}
+class LimitsCheckPass : public FunctionPass {
+public:
+  static char ID;
+
+  LimitsCheckPass(function<bool(Function&)> Check) : FunctionPass(ID), Check(Check) {}
+
+  bool runOnFunction(Function& F) override {
+    if (F.empty() || this->Check(F)) {
+      return false;
+    }
+    // Drop the body and return undef
+    F.dropAllReferences();
+    auto* BB = BasicBlock::Create(F.getContext(), "", &F);
+    if (F.getReturnType()->isVoidTy()) {
+      ReturnInst::Create(F.getContext(), BB);
+    } else {
+      ReturnInst::Create(F.getContext(), UndefValue::get(F.getReturnType()), BB);
+    }
+    return true;
+  }
+
+private:
+  function<bool(Function&)> Check;
+};
+
+char LimitsCheckPass::ID = 0;
+
+}
+
+/*
+  Allocate a new Module, reusing a released one when the recycling is enabled.
+*/
+
+shared_ptr<llvm::Module> Translator::AllocateModule(const string& Name) {
+  // Plain allocation
+  if (!this->Options.RecycleModules) {
+    return make_shared<llvm::Module>(Name, this->Context);
+  }
+  // Reuse a released Module if available
+  llvm::Module* M = nullptr;
+  if (!this->ModulePool->empty()) {
+    M = this->ModulePool->back().release();
+    this->ModulePool->pop_back();
+    // Erase the old content
+    M->dropAllReferences();
+    while (!M->empty()) {
+      M->begin()->eraseFromParent();
+    }
+    while (!M->global_empty()) {
+      M->global_begin()->eraseFromParent();
+    }
+    while (!M->alias_empty()) {
+      M->alias_begin()->eraseFromParent();
+    }
+    while (M->named_metadata_begin() != M->named_metadata_end()) {
+      M->eraseNamedMetadata(&*M->named_metadata_begin());
+    }
+    M->setModuleIdentifier(Name);
+    M->setSourceFileName(Name);
+  } else {
+    M = new llvm::Module(Name, this->Context);
+  }
+  // Give the Module back to the pool once released (if the Translator is still alive)
+  weak_ptr<vector<unique_ptr<llvm::Module>>> Pool = this->ModulePool;
+  return shared_ptr<llvm::Module>(M, [Pool](llvm::Module* M) {
+    if (auto Owner = Pool.lock()) {
+      Owner->emplace_back(M);
+    } else {
+      delete M;
+    }
+  });
+}
 
 /*
   Determine the Triton AST size.
@@ -89,6 +278,123 @@ uint64_t Translator::DetermineASTSize(SharedAbstractNode Node, map<SharedAbstrac
   return Size;
 }
 
+/*
+  Function to measure the references reachable from an AST: the number of nodes of each
+  referenced AST (the nested references and the constant sub-trees count as one node,
+  as they're lifted on their own or folded) and the number of its uses. Each referenced
+  AST is measured only once for a translation, even if reachable from several roots.
+*/
+
+void Translator::MeasureReferences(const SharedAbstractNode& Root) {
+  // ASTs still to be measured, with their expression (nullptr for the root)
+  vector<pair<SharedAbstractNode, SharedExpression>> Pending = { { Root, nullptr } };
+  set<ExpKey> Queued;
+  // The root may be a reference itself
+  if (Root->getType() == ast_e::REFERENCE_NODE) {
+    this->ReferenceUsages[static_cast<ReferenceNode*>(Root.get())->getSymbolicExpression()->getId()].Uses++;
+  }
+  while (!Pending.empty()) {
+    auto Top = Pending.back();
+    Pending.pop_back();
+    // Count the nodes of the AST, and the uses of the references it contains
+    uint64_t Size = 0;
+    set<AbstractNode*> Visited = { Top.first.get() };
+    vector<AbstractNode*> Worklist = { Top.first.get() };
+    while (!Worklist.empty()) {
+      auto* Node = Worklist.back();
+      Worklist.pop_back();
+      Size++;
+      // Queue the referenced AST (unless already measured)
+      if (Node->getType() == ast_e::REFERENCE_NODE) {
+        const auto& Expression = static_cast<ReferenceNode*>(Node)->getSymbolicExpression();
+        if (this->ReferenceUsages[Expression->getId()].Size == 0 && Queued.insert(Expression->getId()).second) {
+          Pending.push_back({ Expression->getAst(), Expression });
+        }
+        continue;
+      }
+      // The constant sub-trees are folded
+      if (!Node->isSymbolized()) {
+        continue;
+      }
+      for (auto& Child : Node->getChildren()) {
+        if (Child->getType() == ast_e::REFERENCE_NODE) {
+          this->ReferenceUsages[static_cast<ReferenceNode*>(Child.get())->getSymbolicExpression()->getId()].Uses++;
+        }
+        if (Visited.insert(Child.get()).second) {
+          Worklist.push_back(Child.get());
+        }
+      }
+    }
+    if (Top.second) {
+      this->ReferenceUsages[Top.second->getId()].Size = Size;
+    }
+  }
+}
+
+/*
+  Function to decide how to lift a reference. The small references are always inlined,
+  the larger ones only while the nodes they copy (once per use) fit the budget. Past the
+  budget a reference is kept as a call, so it's optimized once on its own, and when it's
+  too large even for that it's cut as a fake variable, so it's never lifted at all. The
+  calls read the variables as globals, so they are cut too when the variables are lifted
+  as arguments.
+*/
+
+ReferenceAction Translator::DecideReference(ExpKey Id) {
+  // Reuse the decision taken for the previous uses
+  auto Decided = this->ReferenceActions.find(Id);
+  if (Decided != this->ReferenceActions.end()) {
+    return Decided->second;
+  }
+  const auto& Usage = this->ReferenceUsages[Id];
+  uint64_t Cost = Usage.Size * std::max<uint64_t>(Usage.Uses, 1);
+  auto Action = ReferenceAction::Opaque;
+  if (Usage.Size <= this->Options.InlineSizeFloor) {
+    Action = ReferenceAction::Inline;
+  } else if (this->InlinedNodes + Cost <= this->Options.InlineBudget) {
+    this->InlinedNodes += Cost;
+    Action = ReferenceAction::Inline;
+  } else if (Usage.Size <= this->Options.MaxCallSize && !this->Options.VariablesAsArguments) {
+    Action = ReferenceAction::Call;
+  }
+  #ifdef VERBOSE_OUTPUT
+  cout << "DecideReference: { id = " << dec << Id << ", size = " << Usage.Size << ", uses = " << Usage.Uses << ", action = " << static_cast<int>(Action) << " }" << endl;
+  #endif
+  this->ReferenceActions[Id] = Action;
+  return Action;
+}
+
+/*
+  Function to fetch a reference lifted by another thread from the shared cache. If no
+  thread lifted it yet, it's claimed (false), so the others wait for this thread to
+  publish it instead of lifting it too. The wait honours the limits of the translation:
+  once one is reached, the status tells it (false).
+*/
+
+bool Translator::FetchShared(ExpKey Id, map<ExpKey, shared_ptr<llvm::Module>>& Cache, set<ExpKey>& Claimed) {
+  // Claim the reference (unless published, possibly while waiting)
+  auto Outcome = this->SharedCache->Claim(this->Api, Id, this->Limits.Deadline, this->Limits.Cancelled);
+  if (Outcome == ClaimOutcome::Claimed) {
+    Claimed.insert(Id);
+    return false;
+  }
+  if (Outcome == ClaimOutcome::Expired) {
+    this->CheckLimits();
+    return false;
+  }
+  // Deserialize it in our context
+  auto Bitcode = this->SharedCache->Find(this->Api, Id);
+  if (Bitcode == nullptr) {
+    return false;
+  }
+  auto Module = DeserializeModule(*Bitcode, this->Context);
+  if (Module == nullptr) {
+    return false;
+  }
+  Cache[Id] = Module;
+  return true;
+}
+
 /*
   Converting a Triton AST to a LLVM-IR block.
 */
@@ -108,16 +414,37 @@ ConstantInt* Translator::GetDecimal(IntegerNode& Node, uint64_t BitVectorSize) {
   Worklist-based translation of a Triton AST to an LLVM-IR Module.
 */
 
-Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IRBuilder<>> IR, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth) {
+Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IRBuilder<>> IR, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth, map<SharedAbstractNode, Value*>& Nodes) {
   // Use a dictionary for the known references
   map<triton::usize, triton::engines::symbolic::SharedSymbolicExpression> References;
-  // Use a dictionary for the known AST nodes
-  map<SharedAbstractNode, Value*> Nodes;
-  // Counter for the fake global variable
-  size_t FakeIndex = 0;
+  // Claims on the shared cache (abandoned if the lifting stops before publishing them)
+  struct SharedClaims {
+    SharedReferenceCache* Cache;
+    const API& Api;
+    set<ExpKey> Ids;
+    ~SharedClaims() {
+      for (auto Id : this->Ids) {
+        this->Cache->Abandon(this->Api, Id);
+      }
+    }
+  } Claims{ this->SharedCache, this->Api, {} };
+  // Use dictionaries for the classified MBA shapes and the AST sizes
+  map<AbstractNode*, MBAShape> MBAShapes;
+  map<SharedAbstractNode, uint64_t> MBASizes;
+  // Measure the references before deciding how to lift them
+  if (this->Options.SizeAwareReferences) {
+    this->MeasureReferences(TopNode);
+  }
   // At this point we can translate the AST
   auto Curr = make_shared<AstNode>(TopNode, nullptr);
   while (Curr) {
+    // Abort if a limit of the translation is reached (the clock is read every 256 nodes)
+    this->VisitedNodes++;
+    if ((this->Limits.MaxNodes && this->VisitedNodes > this->Limits.MaxNodes) || (this->VisitedNodes & 0xFF) == 0) {
+      if (!this->CheckLimits()) {
+        return nullptr;
+      }
+    }
     // Print the node
     #ifdef VERBOSE_OUTPUT
     cout << "Handling: " << Curr->Node << endl;
@@ -140,11 +467,14 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
       ss << "FakeVar_";
       ss << dec << Curr->Node->getBitvectorSize();
       ss << "_";
-      ss << dec << FakeIndex++;
+      ss << dec << NextFakeIndex++;
       auto FakeVarName = ss.str();
       auto FakeVar = new GlobalVariable(*this->Module, IntegerType::get(this->Context, Curr->Node->getBitvectorSize()), false, GlobalValue::CommonLinkage, nullptr, FakeVarName);
       auto FakeLoad = IR->CreateLoad(FakeVar);
       Nodes[Curr->Node] = FakeLoad;
+      // Remember the cut sub-tree (also for the translations linking this block later)
+      this->FakeVars[FakeVarName] = Curr->Node;
+      Translator::RegisterFakeVariable(this->Api, FakeVarName, Curr->Node);
       continue;
     }
     // Craft a constant if possible and continue with the parent
@@ -167,8 +497,22 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
       // Restart the loop
       continue;
     }
-    // Fetch the children of the node
-    auto Children = Curr->Node->getChildren();
+    // Replace the known MBA shapes with their minimal equivalent expression
+    if (this->Options.TruthTableLookup && Curr->Index == 0 && !Curr->Rewrite) {
+      Curr->Rewrite = this->LookupMBA(Curr->Node, MBAShapes, MBASizes);
+    }
+    // Fetch the children of the node (the equivalent expression replaces them)
+    auto Children = Curr->Rewrite ? vector<SharedAbstractNode>{ Curr->Rewrite } : Curr->Node->getChildren();
+    // Skip the dead arm of an 'ite' whose condition folded to a constant
+    if (!Curr->Rewrite && Curr->Node->getType() == ast_e::ITE_NODE && (Curr->Index == 1 || Curr->Index == 2)) {
+      auto Condition = Nodes.find(Children[0]);
+      auto* Constant = (Condition != Nodes.end()) ? dyn_cast_or_null<ConstantInt>(Condition->second) : nullptr;
+      if (Constant && Constant->isZero() && Curr->Index == 1) {
+        Curr->Index = 2;
+      } else if (Constant && Constant->isOne() && Curr->Index == 2) {
+        Curr->Index = 3;
+      }
+    }
     // Handle the current node
     if (Curr->Index < Children.size()) {
       // Determine the child depth
@@ -177,6 +521,17 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
       Curr = make_shared<AstNode>(Children[Curr->Index++], Curr);
       // Save the child depth
       Curr->Depth = ChildDepth;
+    } else if (Curr->Rewrite) {
+      #ifdef VERBOSE_OUTPUT
+      cout << "Translating: KNOWN_MBA" << endl;
+      #endif
+      // Reuse the lifted equivalent expression
+      Nodes[Curr->Node] = Nodes[Curr->Rewrite];
+      // Check the counter of the shared pointers
+      Curr->Rewrite.reset();
+      Curr->Node.reset();
+      // Get the parent
+      Curr = Curr->Parent;
     } else {
       #ifdef VERBOSE_OUTPUT
       cout << "Translating: ";
@@ -198,32 +553,93 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
           auto ReferencedExpression = ReferenceAst->getSymbolicExpression();
           // Fetch the referenced AST
           auto ReferencedAst = ReferencedExpression->getAst();
-          // Check if the referenced expression is in the cache
-          if (Cache.find(ReferencedExpression->getId()) != Cache.end()) {
+          // Decide how to lift the reference (once per expression)
+          auto Action = ReferenceAction::Inline;
+          if (this->Options.SizeAwareReferences && this->TraceValues.find(ReferencedExpression->getId()) == this->TraceValues.end()) {
+            Action = this->DecideReference(ReferencedExpression->getId());
+          }
+          // Check if the referenced expression is already a value of the lifted trace
+          if (this->TraceValues.find(ReferencedExpression->getId()) != this->TraceValues.end()) {
+            #ifdef VERBOSE_OUTPUT
+            cout << "[!] Found a reference to the trace, continuing." << endl;
+            #endif
+            Nodes[CNode] = this->TraceValues[ReferencedExpression->getId()];
+          } else if (Action == ReferenceAction::Opaque) {
+            #ifdef VERBOSE_OUTPUT
+            cout << "[!] Found a reference kept opaque, continuing." << endl;
+            #endif
+            // Cut the reference as a fake variable (shared by all its uses)
+            stringstream ss;
+            ss << "OpaqueRef_";
+            ss << dec << CNode->getBitvectorSize();
+            ss << "_";
+            ss << dec << ReferencedExpression->getId();
+            auto FakeVarName = ss.str();
+            auto* FakeVar = this->Module->getNamedGlobal(FakeVarName);
+            if (FakeVar == nullptr) {
+              FakeVar = new GlobalVariable(*this->Module, IntegerType::get(this->Context, CNode->getBitvectorSize()), false, GlobalValue::CommonLinkage, nullptr, FakeVarName);
+            }
+            Nodes[CNode] = IR->CreateLoad(FakeVar);
+            // Remember the cut reference
+            this->FakeVars[FakeVarName] = CNode;
+          } else if (Cache.find(ReferencedExpression->getId()) != Cache.end()) {
             #ifdef VERBOSE_OUTPUT
             cout << "[!] Found a cached reference, continuing." << endl;
             #endif
-            // Clone the Module (we don't want to destroy the original)
-            unique_ptr<llvm::Module> Cloned = llvm::CloneModule(*Cache[ReferencedExpression->getId()]);
             // Generate a proper function name
             string FunName = "ref" + to_string(ReferencedExpression->getId());
-            // Fetch and rename the referenced function
-            auto* RefFun = Cloned->getFunction("TritonAstFunction");
-            RefFun->setName(FunName);
-            // Link the modules together
-            if (Linker::linkModules(*this->Module, std::move(Cloned), llvm::Linker::Flags::OverrideFromSrc)) {
-              cout << "Error while linking the modules" << endl;
-            }
-            // Fetch all the declared global variables
-            for (auto& GVar : this->Module->getGlobalList()) {
-              // Detect the symbolic variables
-              StringRef VarName = GVar.getName();
-              if (VarName.startswith("SymVar")) {
-                this->VarsValue[VarName.str()] = &GVar;
+            // A reference kept as a call is linked only once
+            auto* RefFun = (Action == ReferenceAction::Call) ? this->Module->getFunction(FunName) : nullptr;
+            if (RefFun == nullptr) {
+              // Clone the Module (we don't want to destroy the original)
+              unique_ptr<llvm::Module> Cloned = llvm::CloneModule(*Cache[ReferencedExpression->getId()]);
+              // Fetch and rename the referenced function
+              RefFun = Cloned->getFunction("TritonAstFunction");
+              RefFun->setName(FunName);
+              // Link the modules together
+              if (Linker::linkModules(*this->Module, std::move(Cloned), llvm::Linker::Flags::OverrideFromSrc)) {
+                cout << "Error while linking the modules" << endl;
+              }
+              // Fetch all the declared global variables
+              bool MissingCut = false;
+              for (auto& GVar : this->Module->getGlobalList()) {
+                // Detect the symbolic variables
+                StringRef VarName = GVar.getName();
+                if (VarName.startswith("SymVar")) {
+                  this->VarsValue[VarName.str()] = &GVar;
+                } else if (VarName.startswith("OpaqueRef_")) {
+                  // The references kept opaque by an older translation are cut here too (the
+                  // node may be registered by a thread owning the Triton context)
+                  auto Cut = FindCutNode(this->Api, VarName.str());
+                  if (Cut == nullptr) {
+                    auto Id = stoull(VarName.substr(VarName.rfind('_') + 1).str());
+                    Cut = this->Api.getAstContext()->reference(this->Api.getSymbolicExpression(Id));
+                  }
+                  this->FakeVars[VarName.str()] = Cut;
+                } else if (VarName.startswith("FakeVar_") && this->FakeVars.find(VarName.str()) == this->FakeVars.end()) {
+                  // And so are the sub-trees cut by an older translation
+                  auto Cut = FindCutNode(this->Api, VarName.str());
+                  if (Cut == nullptr) {
+                    cout << "LiftNodesWBS: unknown fake variable " << VarName.str() << endl;
+                    MissingCut = true;
+                  }
+                  this->FakeVars[VarName.str()] = Cut;
+                }
+              }
+              if (MissingCut) {
+                this->Status = TranslationStatus::Failed;
+                return nullptr;
               }
+              // Get the linked copy of the function
+              RefFun = this->Module->getFunction(FunName);
+            }
+            // Keep the call out of line, it only reads the variables
+            if (Action == ReferenceAction::Call) {
+              RefFun->removeFnAttr(Attribute::AlwaysInline);
+              RefFun->addFnAttr(Attribute::NoInline);
+              RefFun->addFnAttr(Attribute::ReadOnly);
+              RefFun->addFnAttr(Attribute::NoUnwind);
             }
-            // Get the linked copy of the function
-            RefFun = this->Module->getFunction(FunName);
             // Call the referenced function
             Nodes[CNode] = IR->CreateCall(RefFun);
           } else if (References.find(ReferencedExpression->getId()) != References.end()) {
@@ -244,6 +660,10 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
             auto* RI = ReturnInst::Create(this->Context, Nodes[ReferencedAst], &EB);
             // Optimize the cloned module
             this->OptimizeModule(this->Module.get());
+            // Never cache a Module whose optimization was aborted
+            if (this->Status != TranslationStatus::Success) {
+              return nullptr;
+            }
             // Debug print the optimized cloned module
             #ifdef VERBOSE_OUTPUT
             cout << "----------- Referenced Module -----------" << endl;
@@ -252,6 +672,10 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
             #endif
             // Cache the optimized cloned module
             Cache[ReferencedExpression->getId()] = this->Module;
+            // Share it with the other threads
+            if (Claims.Ids.erase(ReferencedExpression->getId())) {
+              this->SharedCache->Publish(this->Api, ReferencedExpression->getId(), SerializeModule(*this->Module));
+            }
             // Mark the reference as fully resolved
             References.erase(ReferencedExpression->getId());
             // Restore the previous exploration state
@@ -264,6 +688,15 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
             }
             // Notify we found an unresolved reference
             UnresolvedReference = true;
+          } else if (this->SharedCache && this->FetchShared(ReferencedExpression->getId(), Cache, Claims.Ids)) {
+            #ifdef VERBOSE_OUTPUT
+            cout << "[!] Found a shared reference, caching it." << endl;
+            #endif
+            // Revisit the node, now the reference is cached
+            UnresolvedReference = true;
+          } else if (this->Status != TranslationStatus::Success) {
+            // A limit was reached while waiting for another thread
+            return nullptr;
           } else {
             #ifdef VERBOSE_OUTPUT
             cout << "[!] Found an unresolved reference, adding it to the references to be solved." << endl;
@@ -292,7 +725,7 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
             this->Vars.clear();
             Nodes.clear();
             // Allocate a new module with the proper signature
-            this->Module = make_shared<llvm::Module>("NewTritonAstModule", this->Context);
+            this->Module = this->AllocateModule("NewTritonAstModule");
             // Create the function type (consistent with the top node type)
             auto* TritonAstType = FunctionType::get(IntegerType::get(this->Context, ReferencedAst->getBitvectorSize()), false);
             // Create the function (which will contain the basic block)
@@ -334,7 +767,11 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
           // Get the variable name
           string VarName = Node->getSymbolicVariable()->getName();
           // Determine if it's a known variable
-          if (this->VarsValue.find(VarName) != this->VarsValue.end()) {
+          auto Assigned = this->Assignment.find(VarName);
+          if (Assigned != this->Assignment.end()) {
+            // Substitute its concrete value
+            Nodes[CNode] = this->GetAssignedValue(Assigned->second, CNode->getBitvectorSize());
+          } else if (this->VarsValue.find(VarName) != this->VarsValue.end()) {
             // It's known, fetch the old Value
             Nodes[CNode] = this->VarsValue[VarName];
             // If it's a GlobalVariable, create a load
@@ -719,6 +1156,11 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
           #endif
           // Get the 'if' node
           auto _if = Nodes[Children[0]];
+          // Only the live arm of a constant condition was lifted
+          if (auto* Constant = dyn_cast<ConstantInt>(_if)) {
+            Nodes[CNode] = Nodes[Children[Constant->isOne() ? 1 : 2]];
+            break;
+          }
           // Get the 'then' node
           auto _then = Nodes[Children[1]];
           // Get the 'else' node
@@ -863,7 +1305,9 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
           // Notify we don't support these nodes
           // COMPOUND, DECLARE, INVALID,
           // ASSERT, STRING, IFF, LEFT
-          report_fatal_error("LiftNodesWBS: unsupported node found.");
+          cout << "LiftNodesWBS: unsupported node found." << endl;
+          this->Status = TranslationStatus::Unsupported;
+          return nullptr;
         } break;
       }
       // Check if we found an unresolved reference
@@ -890,27 +1334,65 @@ Value* Translator::LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IR
 }
 
 /*
-  Function to apply the LLVM optimizations to an LLVM-IR Module.
+  Function to apply the LLVM optimizations to an LLVM-IR Module. The pipeline is repeated
+  while the instruction count keeps dropping, until the iteration limit, the time budget
+  or the size floor of the options is reached.
 */
 
 void Translator::OptimizeModule(llvm::Module* M) {
+  auto Start = chrono::steady_clock::now();
   auto PassManager = llvm::legacy::PassManager();
   PassManagerBuilder Builder;
   Builder.OptLevel = 3;
   Builder.SizeLevel = 2;
   Builder.Inliner = createAlwaysInlinerLegacyPass();
+  // Check the translation limits between the optimizations
+  Builder.addExtension(PassManagerBuilder::EP_Peephole, [this](const PassManagerBuilder&, legacy::PassManagerBase& PM) {
+    PM.add(new LimitsCheckPass([this](Function& F) { return this->CheckLimits(F.getInstructionCount()); }));
+  });
   Builder.populateModulePassManager(PassManager);
-  PassManager.run(*M);
-  // Remove all the functions except for TritonAstFunction
-  vector<Function*> ToBeRemoved;
-  for (auto& F : M->functions()) {
-    if (F.getName().startswith("ref")) {
-      ToBeRemoved.push_back(&F);
+  this->OptimizationIterations = 0;
+  auto Size = M->getInstructionCount();
+  while (true) {
+    PassManager.run(*M);
+    this->OptimizationIterations++;
+    // Remove the inlined references, the ones kept as calls are needed by the lift-back
+    // (erasing a reference can leave the ones it calls unused, so repeat until none is left)
+    vector<Function*> ToBeRemoved;
+    do {
+      ToBeRemoved.clear();
+      for (auto& F : M->functions()) {
+        if (F.getName().startswith("ref") && F.use_empty()) {
+          ToBeRemoved.push_back(&F);
+        }
+      }
+      for (auto& F : ToBeRemoved) {
+        F->eraseFromParent();
+      }
+    } while (!ToBeRemoved.empty());
+    // Check the iteration limit (or if a translation limit was reached)
+    if (this->OptimizationIterations >= this->Options.MaxOptimizationIterations || this->Status != TranslationStatus::Success) {
+      break;
+    }
+    // Check if the pipeline reached a fixed-point
+    auto NewSize = M->getInstructionCount();
+    if (NewSize >= Size) {
+      break;
+    }
+    Size = NewSize;
+    // Check the size floor
+    if (Size <= this->Options.OptimizationSizeFloor) {
+      break;
+    }
+    // Check the time budget
+    auto Elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - Start).count();
+    if (this->Options.OptimizationBudget && (uint64_t)Elapsed >= this->Options.OptimizationBudget) {
+      break;
     }
   }
-  for (auto& F : ToBeRemoved) {
-    F->eraseFromParent();
-  }
+  #ifdef VERBOSE_OUTPUT
+  cout << "OptimizeModule: " << this->OptimizationIterations << " iteration(s)" << endl;
+  #endif
   // Strip the weird names
   auto* MF = M->getFunction("TritonAstFunction");
   for (inst_iterator I = inst_begin(MF), E = inst_end(MF); I != E; I++) {
@@ -942,9 +1424,11 @@ void Translator::CloneFunctionInto(Function* SrcFunc, Function* DstFunc) const {
 
 shared_ptr<Module> Translator::TritonAstToLLVMIR(const SharedAbstractNode& node, map<ExpKey, shared_ptr<llvm::Module>>& cache, ssize_t MaxDepth) {
   // Allocate a new Module (the old one is deallocated only if not referenced anymore)
-  this->Module = make_shared<llvm::Module>("TritonAstModule", this->Context);
+  this->Module = this->AllocateModule("TritonAstModule");
   if (Module == nullptr) {
-    report_fatal_error("TritonAstToLLVMIR: failed to allocate Module");
+    cout << "TritonAstToLLVMIR: failed to allocate Module" << endl;
+    this->Status = TranslationStatus::Failed;
+    return nullptr;
   }
   // Create the function type (consistent with the top node type)
   auto* TritonAstType = FunctionType::get(IntegerType::get(this->Context, node->getBitvectorSize()), false);
@@ -957,25 +1441,59 @@ shared_ptr<Module> Translator::TritonAstToLLVMIR(const SharedAbstractNode& node,
   // Clear the old variable Value(s)
   this->VarsValue.clear();
   this->Vars.clear();
+  this->FakeVars.clear();
+  this->ReferenceUsages.clear();
+  this->ReferenceActions.clear();
+  this->InlinedNodes = 0;
+  this->Provenance.clear();
+  // Reset the outcome of the translation
+  this->Status = TranslationStatus::Success;
+  this->VisitedNodes = 0;
+  this->LiftedInstructions = 0;
   // Map for the AST nodes
   map<SharedAbstractNode, Value*> nodes;
   // Initialize the IRBuilder to lift the nodes
   shared_ptr<IRBuilder<>> IR = make_shared<IRBuilder<>>(TritonAstBlock);
   // Traverse the AST in a WBS way (and lift the AST nodes)
-  auto* Value = this->LiftNodesWBS(node, IR, cache, MaxDepth);
+  auto* Value = this->LiftNodesWBS(node, IR, cache, MaxDepth, nodes);
+  if (Value == nullptr) {
+    return nullptr;
+  }
   // Add the return statement
   IR->CreateRet(Value);
+  // Check the instruction budget before optimizing
+  this->LiftedInstructions = TritonAstFunction->getInstructionCount();
+  if (!this->CheckLimits(this->LiftedInstructions)) {
+    return nullptr;
+  }
+  // Specialize the linked references on the assigned variables
+  if (!this->Assignment.empty()) {
+    this->SubstituteAssignment(this->Module.get());
+  }
+  // Turn the variables into arguments if requested
+  if (this->Options.VariablesAsArguments) {
+    this->PromoteVariablesToArguments(this->Module.get());
+  }
+  // Remember the original node of each lifted instruction (unless specialized, the original nodes still read the assigned variables)
+  if (this->Options.ReuseOriginalNodes && this->Assignment.empty()) {
+    this->RecordProvenance(this->Module->getFunction("TritonAstFunction"), nodes);
+  }
 #ifdef DEBUG_OUTPUT
   // DEBUG: show the original ast
   cout << "\nOriginal Triton AST: " << node << endl;
   // DEBUG: dump the Module
-  cout << "\nLifted Triton AST" << endl;
-#endif
-  // Dumping the unoptimized function
   cout << "\n> Unoptimized LLVM-IR Module\n" << endl;
   this->Module->dump();
+#endif
   // Optimize with LLVM
   this->OptimizeModule(this->Module.get());
+  if (this->Status != TranslationStatus::Success) {
+    return nullptr;
+  }
+  // Promote the variables loaded by the inlined references too
+  if (this->Options.VariablesAsArguments) {
+    this->PromoteVariablesToArguments(this->Module.get());
+  }
   // DEBUG: dump the optimized Module
 #ifdef DEBUG_OUTPUT
   cout << "\nOptimized Lifted Triton AST" << endl;
@@ -986,51 +1504,733 @@ shared_ptr<Module> Translator::TritonAstToLLVMIR(const SharedAbstractNode& node,
 }
 
 /*
-  Converting a LLVM-IR basic block to a Triton AST.
+  Public function to lift a Triton AST specialized on the concrete values of some of
+  its variables. The assigned variables are lifted as constants, so IRBuilder folds the
+  sub-trees depending only on them while they are lifted, and the dead arm of an 'ite'
+  with a folded condition isn't lifted at all. The references lifted here depend on the
+  assignment, so they are cached in a copy of the cache and never leak to the caller.
 */
 
-SharedAbstractNode Translator::LiftInstructionsDFS(Value* value, map<Value*, SharedAbstractNode>& values, map<string, SharedAbstractNode>& variables) {
-  // DEBUG: show input value
-#ifdef VERBOSE_OUTPUT
-  cout << "Input value: " << endl;
-  cout << "------------" << endl;
-  value->dump();
-  cout << "------------" << endl;
+shared_ptr<Module> Translator::TritonAstToLLVMIR(const SharedAbstractNode& Node, const map<string, uint512>& Assignment, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth) {
+  // Use a private copy of the cache for the specialized references
+  auto Specialized = Cache;
+  // The specialized references can't be shared with the other threads either
+  auto* Shared = this->SharedCache;
+  this->SharedCache = nullptr;
+  // Lift with the assigned variables
+  this->Assignment = Assignment;
+  auto Module = this->TritonAstToLLVMIR(Node, Specialized, MaxDepth);
+  this->Assignment.clear();
+  this->SharedCache = Shared;
+  return Module;
+}
+
+/*
+  Public function to simplify a Triton AST with respect to the variables which aren't
+  part of a partial assignment (e.g. a fixed key or a configuration flag).
+*/
+
+SharedAbstractNode Translator::PartiallyEvaluate(const SharedAbstractNode& Node, const map<string, uint512>& Assignment, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, ssize_t MaxDepth) {
+  // Lift the AST specialized on the assignment
+  auto Module = this->TritonAstToLLVMIR(Node, Assignment, Cache, MaxDepth);
+  if (Module == nullptr) {
+    return nullptr;
+  }
+  // Restore the sub-trees cut at the maximum depth
+  auto LiftVariables = Variables;
+  for (auto& FakeVar : this->FakeVars) {
+    LiftVariables[FakeVar.first] = FakeVar.second;
+  }
+  // Translate back to a Triton AST (of the same kind)
+  return this->LLVMIRToTritonAst(Module, LiftVariables, false, Node->isLogical());
+}
+
+/*
+  Public function to simplify a Triton AST within the given limits. When a limit is
+  reached, or the AST can't be translated, the status tells why and Result is the
+  original AST, so a single bad expression never stops a batch.
+*/
+
+TranslationStatus Translator::Simplify(const SharedAbstractNode& Node, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, SharedAbstractNode& Result, const TranslationLimits& Limits, ssize_t MaxDepth) {
+  // Keep the original AST unless the translation succeeds
+  Result = Node;
+  // Translate with the given limits
+  auto PreviousLimits = this->Limits;
+  this->Limits = Limits;
+  auto Module = this->TritonAstToLLVMIR(Node, Cache, MaxDepth);
+  this->Limits = PreviousLimits;
+  if (Module == nullptr) {
+    return this->Status;
+  }
+  // Restore the sub-trees cut at the maximum depth (in a copy, so the caller's map doesn't keep them alive)
+  auto LiftVariables = Variables;
+  for (auto& FakeVar : this->FakeVars) {
+    LiftVariables[FakeVar.first] = FakeVar.second;
+  }
+  // Translate back to a Triton AST (of the same kind)
+  auto Simplified = this->LLVMIRToTritonAst(Module, LiftVariables, false, Node->isLogical());
+  if (Simplified == nullptr) {
+    if (this->Status == TranslationStatus::Success) {
+      this->Status = TranslationStatus::Failed;
+    }
+    return this->Status;
+  }
+  Result = Simplified;
+  return this->Status;
+}
+
+/*
+  Public function to lift multiple Triton ASTs in a single LLVM-IR Module.
+
+  The roots share the lifted nodes, so their common sub-expressions are lifted and
+  optimized only once; TritonAstFunction returns a structure with a field per root.
+*/
+
+shared_ptr<Module> Translator::TritonAstsToLLVMIR(const vector<SharedAbstractNode>& Roots, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth) {
+  // Allocate a new Module (the old one is deallocated only if not referenced anymore)
+  this->Module = this->AllocateModule("TritonAstModule");
+  // Create the function type (a field for each root)
+  vector<Type*> Fields;
+  for (auto& Root : Roots) {
+    Fields.push_back(IntegerType::get(this->Context, Root->getBitvectorSize()));
+  }
+  auto* ReturnType = StructType::get(this->Context, Fields);
+  auto* TritonAstType = FunctionType::get(ReturnType, false);
+  // Create the function (which will contain the basic block)
+  auto* TritonAstFunction = Function::Create(TritonAstType, llvm::Function::CommonLinkage, "TritonAstFunction", this->Module.get());
+  // Mark the function as always inlineable
+  TritonAstFunction->addFnAttr(Attribute::AlwaysInline);
+  // Create the only basic block (which will contain the lifted instructions)
+  auto* TritonAstBlock = BasicBlock::Create(this->Context, "TritonAstEntry", TritonAstFunction);
+  // Clear the old variable Value(s)
+  this->VarsValue.clear();
+  this->Vars.clear();
+  this->FakeVars.clear();
+  this->ReferenceUsages.clear();
+  this->ReferenceActions.clear();
+  this->InlinedNodes = 0;
+  this->Provenance.clear();
+  // Reset the outcome of the translation
+  this->Status = TranslationStatus::Success;
+  this->VisitedNodes = 0;
+  this->LiftedInstructions = 0;
+  // Map for the AST nodes (shared by all the roots)
+  map<SharedAbstractNode, Value*> Nodes;
+  // Initialize the IRBuilder to lift the nodes
+  shared_ptr<IRBuilder<>> IR = make_shared<IRBuilder<>>(TritonAstBlock);
+  // Lift each root and store it in its field
+  Value* Aggregate = UndefValue::get(ReturnType);
+  for (unsigned i = 0; i < Roots.size(); i++) {
+    auto* Value = this->LiftNodesWBS(Roots[i], IR, Cache, MaxDepth, Nodes);
+    if (Value == nullptr) {
+      return nullptr;
+    }
+    Aggregate = IR->CreateInsertValue(Aggregate, Value, i);
+  }
+  // Add the return statement
+  IR->CreateRet(Aggregate);
+  // Check the instruction budget before optimizing
+  this->LiftedInstructions = TritonAstFunction->getInstructionCount();
+  if (!this->CheckLimits(this->LiftedInstructions)) {
+    return nullptr;
+  }
+  // Turn the variables into arguments if requested
+  if (this->Options.VariablesAsArguments) {
+    this->PromoteVariablesToArguments(this->Module.get());
+  }
+  // Remember the original node of each lifted instruction
+  if (this->Options.ReuseOriginalNodes && this->Assignment.empty()) {
+    this->RecordProvenance(this->Module->getFunction("TritonAstFunction"), Nodes);
+  }
+#ifdef DEBUG_OUTPUT
+  cout << "\n> Unoptimized LLVM-IR Module\n" << endl;
+  this->Module->dump();
 #endif
-  // Check if we already lifted this value
-  if (values.find(value) != values.end()) {
-    return values[value];
+  // Optimize with LLVM
+  this->OptimizeModule(this->Module.get());
+  if (this->Status != TranslationStatus::Success) {
+    return nullptr;
   }
-  // Get a reference to the ast context
-  auto Ctx = this->Api.getAstContext();
-  // We need to create a new SharedAbstractNode
-  SharedAbstractNode node = nullptr;
-  // Check if we are dealing with an undefined value
-  if (auto UndefinedValue = dyn_cast<UndefValue>(value)) {
-    // Return a 0 value by default, although making it symbolic would be better
-    outs() << "[!] Found undefined value, returning a null bitvector (a new symbolic value would be better)\n";
-    // Create a new zero bitvector
-    node = Ctx->bv(0, value->getType()->getIntegerBitWidth());
-  } else if (auto* CI = dyn_cast<ConstantInt>(value)) {
-    // Check if we are dealing with a constant value
-    const auto& Val = CI->getValue();
-    // Convert the value into a string
-    stringstream ss;
-    ss << dec << Val.toString(10, false);
-    triton::uint512 IntVal{ss.str()};
-    // Create a new bitvector
-    node = Ctx->bv(IntVal, Val.getBitWidth());
-  } else if (auto Inst = dyn_cast<llvm::Instruction>(value)) {
-    // Lift the instruction into an ast node
-    switch (Inst->getOpcode()) {
-        // Handle terminal instructions
-      case llvm::Instruction::Load: {
-        auto* GlobalVar = Inst->getOperand(0);
-        #ifdef VERBOSE_OUTPUT
-        outs() << "Found global variable loading:\n";
-        GlobalVar->dump();
-        // auto var = this->Api.getSymbolicVariable(GlobalVar->getName().str());
-        // outs() << "Triton symbolic variable:\n";
+  // Promote the variables loaded by the inlined references too
+  if (this->Options.VariablesAsArguments) {
+    this->PromoteVariablesToArguments(this->Module.get());
+  }
+#ifdef DEBUG_OUTPUT
+  cout << "\nOptimized Lifted Triton ASTs" << endl;
+  this->Module->dump();
+#endif
+  // Return the generated Module
+  return this->Module;
+}
+
+/*
+  Public function to collect the expressions of a trace: the given ones and the ones they
+  reference (transitively), sorted by ID, so every expression comes after the ones it
+  references.
+*/
+
+vector<SharedExpression> Translator::CollectTrace(const vector<SharedExpression>& Expressions) const {
+  map<ExpKey, SharedExpression> Trace;
+  set<AbstractNode*> Visited;
+  vector<SharedAbstractNode> Worklist;
+  for (auto& Expression : Expressions) {
+    if (Trace.emplace(Expression->getId(), Expression).second) {
+      Worklist.push_back(Expression->getAst());
+    }
+  }
+  // Follow the references of the ASTs
+  while (!Worklist.empty()) {
+    auto Node = Worklist.back();
+    Worklist.pop_back();
+    if (!Visited.insert(Node.get()).second) {
+      continue;
+    }
+    if (Node->getType() == ast_e::REFERENCE_NODE) {
+      auto& Expression = static_cast<ReferenceNode*>(Node.get())->getSymbolicExpression();
+      if (Trace.emplace(Expression->getId(), Expression).second) {
+        Worklist.push_back(Expression->getAst());
+      }
+      continue;
+    }
+    for (auto& Child : Node->getChildren()) {
+      Worklist.push_back(Child);
+    }
+  }
+  vector<SharedExpression> Sorted;
+  for (auto& Entry : Trace) {
+    Sorted.push_back(Entry.second);
+  }
+  return Sorted;
+}
+
+/*
+  Public function to lift a whole trace in a single LLVM-IR block: each expression is
+  lifted once, in ID order, and the references to it become uses of its value (instead
+  of a call to a separately optimized Module). The returned structure holds the
+  requested expressions, so the pipeline runs once on the whole trace and everything
+  not needed by them is dropped.
+*/
+
+shared_ptr<Module> Translator::TritonTraceToLLVMIR(const vector<SharedExpression>& Trace, const vector<SharedExpression>& Requested, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth) {
+  // Complete the trace with the referenced expressions (no Module swap is ever needed)
+  auto Expressions = Trace;
+  Expressions.insert(Expressions.end(), Requested.begin(), Requested.end());
+  Expressions = this->CollectTrace(Expressions);
+  // Allocate a new Module (the old one is deallocated only if not referenced anymore)
+  this->Module = this->AllocateModule("TritonTraceModule");
+  if (this->Module == nullptr) {
+    cout << "TritonTraceToLLVMIR: failed to allocate Module" << endl;
+    this->Status = TranslationStatus::Failed;
+    return nullptr;
+  }
+  // Create the function type (a field for each requested expression)
+  vector<Type*> Fields;
+  for (auto& Expression : Requested) {
+    Fields.push_back(IntegerType::get(this->Context, Expression->getAst()->getBitvectorSize()));
+  }
+  auto* ReturnType = StructType::get(this->Context, Fields);
+  auto* TritonAstType = FunctionType::get(ReturnType, false);
+  // Create the function (which will contain the basic block)
+  auto* TritonAstFunction = Function::Create(TritonAstType, llvm::Function::CommonLinkage, "TritonAstFunction", this->Module.get());
+  // Mark the function as always inlineable
+  TritonAstFunction->addFnAttr(Attribute::AlwaysInline);
+  // Create the only basic block (which will contain the lifted instructions)
+  auto* TritonAstBlock = BasicBlock::Create(this->Context, "TritonAstEntry", TritonAstFunction);
+  // Clear the old variable Value(s)
+  this->VarsValue.clear();
+  this->Vars.clear();
+  this->FakeVars.clear();
+  this->ReferenceUsages.clear();
+  this->ReferenceActions.clear();
+  this->InlinedNodes = 0;
+  this->Provenance.clear();
+  this->TraceValues.clear();
+  // Reset the outcome of the translation
+  this->Status = TranslationStatus::Success;
+  this->VisitedNodes = 0;
+  this->LiftedInstructions = 0;
+  // Map for the AST nodes (shared by all the expressions)
+  map<SharedAbstractNode, Value*> Nodes;
+  // Initialize the IRBuilder to lift the nodes
+  shared_ptr<IRBuilder<>> IR = make_shared<IRBuilder<>>(TritonAstBlock);
+  // Lift each expression as a value of the block
+  for (auto& Expression : Expressions) {
+    auto* Value = this->LiftNodesWBS(Expression->getAst(), IR, Cache, MaxDepth, Nodes);
+    if (Value == nullptr) {
+      this->TraceValues.clear();
+      return nullptr;
+    }
+    this->TraceValues[Expression->getId()] = Value;
+  }
+  // Store the requested expressions in their fields
+  Value* Aggregate = UndefValue::get(ReturnType);
+  for (unsigned i = 0; i < Requested.size(); i++) {
+    Aggregate = IR->CreateInsertValue(Aggregate, this->TraceValues[Requested[i]->getId()], i);
+  }
+  this->TraceValues.clear();
+  // Add the return statement
+  IR->CreateRet(Aggregate);
+  // Check the instruction budget before optimizing
+  this->LiftedInstructions = TritonAstFunction->getInstructionCount();
+  if (!this->CheckLimits(this->LiftedInstructions)) {
+    return nullptr;
+  }
+  // Turn the variables into arguments if requested
+  if (this->Options.VariablesAsArguments) {
+    this->PromoteVariablesToArguments(this->Module.get());
+  }
+  // Remember the original node of each lifted instruction
+  if (this->Options.ReuseOriginalNodes && this->Assignment.empty()) {
+    this->RecordProvenance(this->Module->getFunction("TritonAstFunction"), Nodes);
+  }
+#ifdef DEBUG_OUTPUT
+  cout << "\n> Unoptimized LLVM-IR Module\n" << endl;
+  this->Module->dump();
+#endif
+  // Optimize the whole trace at once
+  this->OptimizeModule(this->Module.get());
+  if (this->Status != TranslationStatus::Success) {
+    return nullptr;
+  }
+#ifdef DEBUG_OUTPUT
+  cout << "\nOptimized Lifted Trace" << endl;
+  this->Module->dump();
+#endif
+  // Return the generated Module
+  return this->Module;
+}
+
+/*
+  Public function to simplify some expressions of a trace: the trace is lifted in a
+  single block, optimized once, and a Triton AST is lifted back for each requested
+  expression (sharing their nodes).
+*/
+
+vector<SharedAbstractNode> Translator::SimplifyTrace(const vector<SharedExpression>& Requested, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, ssize_t MaxDepth) {
+  auto Module = this->TritonTraceToLLVMIR({}, Requested, Cache, MaxDepth);
+  if (Module == nullptr) {
+    return {};
+  }
+  // Restore the sub-trees cut at the maximum depth
+  auto LiftVariables = Variables;
+  for (auto& FakeVar : this->FakeVars) {
+    LiftVariables[FakeVar.first] = FakeVar.second;
+  }
+  auto Asts = this->LLVMIRToTritonAsts(Module, LiftVariables);
+  if (Asts.size() != Requested.size()) {
+    if (this->Status == TranslationStatus::Success) {
+      this->Status = TranslationStatus::Failed;
+    }
+    // Give back the original expressions if the block can't be lifted back
+    Asts.clear();
+    for (auto& Expression : Requested) {
+      Asts.push_back(Expression->getAst());
+    }
+    return Asts;
+  }
+  // Give back the logical expressions as such
+  for (unsigned i = 0; i < Asts.size(); i++) {
+    if (Requested[i]->getAst()->isLogical()) {
+      Asts[i] = this->ConvertToLogical(this->UndoICmpBehavior(Asts[i]));
+    }
+  }
+  return Asts;
+}
+
+/*
+  Function to remember the state of a lifted function before the optimizations: the
+  shape of each instruction and the original node it was lifted from. If more nodes
+  were lifted to the same instruction (i.e. a known MBA and its minimal expression),
+  the smallest one is kept.
+*/
+
+void Translator::RecordProvenance(Function* F, const map<SharedAbstractNode, Value*>& Nodes) {
+  this->Provenance.clear();
+  // Take a snapshot of the instructions
+  for (auto& I : instructions(F)) {
+    auto& Record = this->Provenance[&I];
+    Record.Value = &I;
+    Record.Opcode = I.getOpcode();
+    if (auto* Cmp = dyn_cast<CmpInst>(&I)) {
+      Record.Predicate = Cmp->getPredicate();
+    }
+    for (auto& Operand : I.operands()) {
+      Record.Operands.push_back(Operand.get());
+    }
+  }
+  // Attach the original nodes
+  map<SharedAbstractNode, uint64_t> Sizes;
+  for (auto& Entry : Nodes) {
+    auto Record = this->Provenance.find(Entry.second);
+    if (Record == this->Provenance.end() || !Entry.second->getType()->isIntegerTy()) {
+      continue;
+    }
+    if (Entry.first->getBitvectorSize() != Entry.second->getType()->getIntegerBitWidth()) {
+      continue;
+    }
+    auto& Node = Record->second.Node;
+    if (Node == nullptr || this->DetermineASTSize(Entry.first, Sizes) < this->DetermineASTSize(Node, Sizes)) {
+      Node = Entry.first;
+    }
+  }
+}
+
+/*
+  Function to check if an instruction is still the one lifted: same opcode, predicate
+  and operands, with the instruction operands untouched as well. Such an instruction
+  computes exactly its original node.
+*/
+
+bool Translator::IsUntouched(Value* V) {
+  auto It = this->Provenance.find(V);
+  if (It == this->Provenance.end()) {
+    return false;
+  }
+  auto& Record = It->second;
+  // The instruction was deleted (another one may have reused its address)
+  if (Record.Value != V) {
+    return false;
+  }
+  if (Record.Untouched != -1) {
+    return Record.Untouched;
+  }
+  // Check the shape of the instruction
+  auto* Inst = dyn_cast<llvm::Instruction>(V);
+  bool Untouched = Inst->getOpcode() == Record.Opcode && Inst->getNumOperands() == Record.Operands.size();
+  if (Untouched) {
+    if (auto* Cmp = dyn_cast<CmpInst>(Inst)) {
+      Untouched = Cmp->getPredicate() == Record.Predicate;
+    }
+  }
+  // Check the operands
+  for (unsigned i = 0; Untouched && i < Inst->getNumOperands(); i++) {
+    auto* Operand = Inst->getOperand(i);
+    Untouched = (Record.Operands[i] == Operand) && (!isa<llvm::Instruction>(Operand) || this->IsUntouched(Operand));
+  }
+  // Save the outcome (the iterator is still valid, the map is only read)
+  It->second.Untouched = Untouched;
+  return Untouched;
+}
+
+/*
+  Function to get the original node of a value left untouched by the optimizations, so
+  the unchanged parts of an AST are shared with it instead of being rebuilt.
+*/
+
+SharedAbstractNode Translator::GetOriginalNode(Value* V) {
+  auto It = this->Provenance.find(V);
+  if (It == this->Provenance.end() || It->second.Node == nullptr || !this->IsUntouched(V)) {
+    return nullptr;
+  }
+  // The comparisons are lifted back wrapped in an 'ite'
+  auto Node = It->second.Node;
+  return Node->isLogical() ? this->FixICmpBehavior(Node) : Node;
+}
+
+/*
+  Function to run the analyses used to narrow the values of a function lifted back; the
+  analyses of the previous function are always dropped.
+*/
+
+void Translator::PrepareNarrowing(Function* F) {
+  // Drop the previous analyses (in reverse dependency order)
+  this->Demanded.reset();
+  this->Dominators.reset();
+  this->Assumptions.reset();
+  if (F == nullptr || !this->Options.NarrowKnownBits) {
+    return;
+  }
+  this->Assumptions = std::make_unique<AssumptionCache>(*F);
+  this->Dominators = std::make_unique<DominatorTree>(*F);
+  this->Demanded = std::make_unique<DemandedBits>(*F, *this->Assumptions, *this->Dominators);
+}
+
+/*
+  Function to get the low bits of a node. The constants, concatenations, extensions and
+  extractions of the lowest bits already expose them, so no 'extract' is added on top.
+*/
+
+SharedAbstractNode Translator::LowBits(const SharedAbstractNode& Node, uint32 Width) {
+  // Fetch the AST context
+  auto Ctx = this->Api.getAstContext();
+  if (Node->getBitvectorSize() == Width) {
+    return Node;
+  }
+  auto& Children = Node->getChildren();
+  switch (Node->getType()) {
+    case ast_e::BV_NODE: {
+      // Truncate the constant
+      return Ctx->bv(Node->evaluate() & ((triton::uint512(1) << Width) - 1), Width);
+    }
+    case ast_e::CONCAT_NODE: {
+      // The last child holds the lowest bits
+      auto& Last = Children.back();
+      if (Last->getBitvectorSize() >= Width) {
+        return this->LowBits(Last, Width);
+      }
+    } break;
+    case ast_e::ZX_NODE:
+    case ast_e::SX_NODE: {
+      // Extend the inner node less (or not at all)
+      auto& Inner = Children[1];
+      auto InnerSize = Inner->getBitvectorSize();
+      if (InnerSize >= Width) {
+        return this->LowBits(Inner, Width);
+      }
+      return (Node->getType() == ast_e::ZX_NODE) ? Ctx->zx(Width - InnerSize, Inner) : Ctx->sx(Width - InnerSize, Inner);
+    }
+    case ast_e::EXTRACT_NODE: {
+      // Extract fewer bits of the inner node
+      if (Children[1]->evaluate() == 0) {
+        return this->LowBits(Children[2], Width);
+      }
+    } break;
+    default: break;
+  }
+  return Ctx->extract(Width - 1, 0, Node);
+}
+
+/*
+  Function to narrow a lifted instruction using the bits known by LLVM: the bits which
+  are known (or not demanded by any user, so free to be zero) become constants and only
+  the range of the unknown bits is computed, wrapped in a 'concat' (or 'zx'). The
+  operations whose low bits only depend on the low bits of their operands are rebuilt
+  at the narrow width; the other ones are computed at full width and extracted.
+*/
+
+SharedAbstractNode Translator::NarrowValue(llvm::Instruction* Inst, const SharedAbstractNode& Node) {
+  // Fetch the AST context
+  auto Ctx = this->Api.getAstContext();
+  auto Width = Inst->getType()->getIntegerBitWidth();
+  // Compute the known and the demanded bits
+  auto Known = computeKnownBits(Inst, Inst->getModule()->getDataLayout(), 0, this->Assumptions.get(), Inst, this->Dominators.get());
+  auto Demanded = this->Demanded->getDemandedBits(Inst);
+  auto Unknown = ~(Known.Zero | Known.One) & Demanded;
+  auto Constant = Known.One & Demanded;
+  // Convert a constant part
+  auto ToInteger = [](const APInt& Value) {
+    stringstream ss;
+    ss << dec << Value.toString(10, false);
+    return triton::uint512{ ss.str() };
+  };
+  if (Unknown.isNullValue()) {
+    return Ctx->bv(ToInteger(Constant), Width);
+  }
+  uint32 High = Unknown.getActiveBits() - 1;
+  uint32 Low = Unknown.countTrailingZeros();
+  // Known low bits alone don't make the computation narrower
+  if (High == Width - 1) {
+    return Node;
+  }
+  // Operations commuting with the truncation
+  static const set<ast_e> Truncatable = {
+    ast_e::BVADD_NODE, ast_e::BVSUB_NODE, ast_e::BVMUL_NODE, ast_e::BVAND_NODE, ast_e::BVOR_NODE,
+    ast_e::BVXOR_NODE, ast_e::BVNOT_NODE, ast_e::BVNEG_NODE, ast_e::ITE_NODE
+  };
+  SharedAbstractNode Core = nullptr;
+  if (Truncatable.find(Node->getType()) != Truncatable.end()) {
+    vector<SharedAbstractNode> Children;
+    for (auto& Child : Node->getChildren()) {
+      // The condition of an 'ite' is logical
+      Children.push_back(Child->isLogical() ? Child : this->LowBits(Child, High + 1));
+    }
+    // Drop the neutral masks left by the narrowing (i.e. 'and' with 0xFF at 8 bits)
+    if (Children.size() == 2 && Children[1]->getType() == ast_e::BV_NODE) {
+      auto Mask = Children[1]->evaluate();
+      auto Ones = (triton::uint512(1) << (High + 1)) - 1;
+      if ((Node->getType() == ast_e::BVAND_NODE && Mask == Ones) || (Mask == 0 && (Node->getType() == ast_e::BVOR_NODE || Node->getType() == ast_e::BVXOR_NODE))) {
+        Core = Children[0];
+      }
+    }
+    if (Core == nullptr) {
+      Core = RebuildNode(Ctx, Node->getType(), Children, {});
+    }
+  }
+  if (Core == nullptr) {
+    Core = this->LowBits(Node, High + 1);
+  }
+  // Assemble the constant and the unknown parts
+  auto Middle = (Low > 0) ? Ctx->extract(High, Low, Core) : Core;
+  auto HighPart = Constant.lshr(High + 1).trunc(Width - High - 1);
+  if (HighPart.isNullValue() && Low == 0) {
+    return Ctx->zx(Width - High - 1, Middle);
+  }
+  vector<SharedAbstractNode> Parts;
+  Parts.push_back(Ctx->bv(ToInteger(HighPart), Width - High - 1));
+  Parts.push_back(Middle);
+  if (Low > 0) {
+    Parts.push_back(Ctx->bv(ToInteger(Constant.trunc(Low)), Low));
+  }
+  return Ctx->concat(Parts);
+}
+
+/*
+  Function to recover the compact Triton node of the idioms generated by the lifting (or
+  by the optimizations of their canonical forms):
+  - 'trunc (lshr X, C)' -> 'extract';
+  - 'and (lshr X, C), 2^k-1' and 'and X, 2^k-1' -> 'zx' of an 'extract';
+  - trees of 'or' of disjoint 'zext' and 'shl (zext)' -> 'concat' (with 'zx' and zero gaps);
+  - 'zext'/'sext' of a comparison -> 'ite' with the extended constants.
+  Returns nullptr if the value isn't a known idiom.
+*/
+
+SharedAbstractNode Translator::RecoverIdiom(Value* value, map<Value*, SharedAbstractNode>& values, map<string, SharedAbstractNode>& variables) {
+  using namespace llvm::PatternMatch;
+  // Fetch the AST context
+  auto Ctx = this->Api.getAstContext();
+  auto* Inst = dyn_cast<llvm::Instruction>(value);
+  if (Inst == nullptr || !Inst->getType()->isIntegerTy()) {
+    return nullptr;
+  }
+  uint32 Width = Inst->getType()->getIntegerBitWidth();
+  Value* X = nullptr;
+  const APInt* C = nullptr;
+  const APInt* M = nullptr;
+  // Extraction of the bits [C+Width-1:C]
+  if (match(Inst, m_Trunc(m_LShr(m_Value(X), m_APInt(C)))) || match(Inst, m_Trunc(m_AShr(m_Value(X), m_APInt(C))))) {
+    auto Shift = C->getLimitedValue();
+    if (Shift + Width <= X->getType()->getIntegerBitWidth()) {
+      return Ctx->extract(Shift + Width - 1, Shift, this->LiftInstructionsDFS(X, values, variables));
+    }
+    return nullptr;
+  }
+  // Extraction of the bits [C+k-1:C], zero extended
+  if (match(Inst, m_And(m_Value(X), m_APInt(M))) && M->isMask() && M->countTrailingOnes() < Width) {
+    uint32 Bits = M->countTrailingOnes();
+    uint64_t Shift = 0;
+    Value* Y = nullptr;
+    if (match(X, m_LShr(m_Value(Y), m_APInt(C)))) {
+      X = Y;
+      Shift = C->getLimitedValue();
+      if (Shift + Bits > Width) {
+        return nullptr;
+      }
+    }
+    auto Extract = Ctx->extract(Shift + Bits - 1, Shift, this->LiftInstructionsDFS(X, values, variables));
+    return Ctx->zx(Width - Bits, Extract);
+  }
+  // Comparison extended to a bitvector
+  if ((isa<ZExtInst>(Inst) || isa<SExtInst>(Inst)) && isa<ICmpInst>(Inst->getOperand(0))) {
+    auto Condition = this->UndoICmpBehavior(this->LiftInstructionsDFS(Inst->getOperand(0), values, variables));
+    Condition = this->ConvertToLogical(Condition);
+    auto One = isa<ZExtInst>(Inst) ? Ctx->bv(1, Width) : Ctx->bv((triton::uint512(1) << Width) - 1, Width);
+    return Ctx->ite(Condition, One, Ctx->bv(0, Width));
+  }
+  // Concatenation of disjoint pieces
+  if (Inst->getOpcode() != llvm::Instruction::Or) {
+    return nullptr;
+  }
+  // Collect the terms of the 'or' tree (the inner nodes must not be used elsewhere)
+  vector<Value*> Terms;
+  vector<Value*> Worklist = { Inst };
+  while (!Worklist.empty()) {
+    auto* Curr = Worklist.back();
+    Worklist.pop_back();
+    auto* Or = dyn_cast<BinaryOperator>(Curr);
+    if (Or && Or->getOpcode() == llvm::Instruction::Or && (Or == Inst || Or->hasOneUse())) {
+      Worklist.push_back(Or->getOperand(1));
+      Worklist.push_back(Or->getOperand(0));
+    } else {
+      Terms.push_back(Curr);
+    }
+  }
+  // Match each term as a zero extended value at an offset
+  map<uint64_t, Value*, greater<uint64_t>> Pieces;
+  for (auto* Term : Terms) {
+    Value* Piece = nullptr;
+    uint64_t Offset = 0;
+    if (match(Term, m_Shl(m_ZExt(m_Value(Piece)), m_APInt(C)))) {
+      Offset = C->getLimitedValue();
+    } else if (!match(Term, m_ZExt(m_Value(Piece)))) {
+      return nullptr;
+    }
+    if (Offset + Piece->getType()->getIntegerBitWidth() > Width || Pieces.find(Offset) != Pieces.end()) {
+      return nullptr;
+    }
+    Pieces[Offset] = Piece;
+  }
+  // Build the concatenation from the highest piece, filling the gaps with zeros
+  vector<SharedAbstractNode> Parts;
+  uint64_t Top = Width;
+  for (auto& Piece : Pieces) {
+    auto Size = Piece.second->getType()->getIntegerBitWidth();
+    if (Piece.first + Size > Top) {
+      // Overlapping pieces
+      return nullptr;
+    }
+    if (Piece.first + Size < Top && !Parts.empty()) {
+      Parts.push_back(Ctx->bv(0, Top - Piece.first - Size));
+    }
+    Parts.push_back(this->LiftInstructionsDFS(Piece.second, values, variables));
+    Top = Piece.first;
+  }
+  if (Top > 0) {
+    Parts.push_back(Ctx->bv(0, Top));
+  }
+  auto Concat = (Parts.size() > 1) ? Ctx->concat(Parts) : Parts[0];
+  // Extend the highest piece to the full width
+  auto Size = Concat->getBitvectorSize();
+  return (Size < Width) ? Ctx->zx(Width - Size, Concat) : Concat;
+}
+
+/*
+  Converting a LLVM-IR basic block to a Triton AST.
+*/
+
+SharedAbstractNode Translator::LiftInstructionsDFS(Value* value, map<Value*, SharedAbstractNode>& values, map<string, SharedAbstractNode>& variables) {
+  // DEBUG: show input value
+#ifdef VERBOSE_OUTPUT
+  cout << "Input value: " << endl;
+  cout << "------------" << endl;
+  value->dump();
+  cout << "------------" << endl;
+#endif
+  // Check if we already lifted this value
+  if (values.find(value) != values.end()) {
+    return values[value];
+  }
+  // Reuse the original node of a value left untouched by the optimizations
+  if (!this->Provenance.empty()) {
+    if (auto Original = this->GetOriginalNode(value)) {
+      values[value] = Original;
+      return Original;
+    }
+  }
+  // Get a reference to the ast context
+  auto Ctx = this->Api.getAstContext();
+  // We need to create a new SharedAbstractNode
+  SharedAbstractNode node = nullptr;
+  // Check if we are dealing with an undefined value
+  if (auto UndefinedValue = dyn_cast<UndefValue>(value)) {
+    // Return a 0 value by default, although making it symbolic would be better
+    outs() << "[!] Found undefined value, returning a null bitvector (a new symbolic value would be better)\n";
+    // Create a new zero bitvector
+    node = Ctx->bv(0, value->getType()->getIntegerBitWidth());
+  } else if (auto* CI = dyn_cast<ConstantInt>(value)) {
+    // Check if we are dealing with a constant value
+    const auto& Val = CI->getValue();
+    // Convert the value into a string
+    stringstream ss;
+    ss << dec << Val.toString(10, false);
+    triton::uint512 IntVal{ss.str()};
+    // Create a new bitvector
+    node = Ctx->bv(IntVal, Val.getBitWidth());
+  } else if (auto* Arg = dyn_cast<Argument>(value)) {
+    // Variables lifted as arguments are resolved by their index
+    node = this->ArgumentNodes[Arg->getArgNo()];
+  } else if (this->Options.RecoverIdioms && (node = this->RecoverIdiom(value, values, variables)) != nullptr) {
+    // The compact form of an idiom was recovered
+  } else if (auto Inst = dyn_cast<llvm::Instruction>(value)) {
+    // Lift the instruction into an ast node
+    switch (Inst->getOpcode()) {
+        // Handle terminal instructions
+      case llvm::Instruction::Load: {
+        auto* GlobalVar = Inst->getOperand(0);
+        #ifdef VERBOSE_OUTPUT
+        outs() << "Found global variable loading:\n";
+        GlobalVar->dump();
+        // auto var = this->Api.getSymbolicVariable(GlobalVar->getName().str());
+        // outs() << "Triton symbolic variable:\n";
         // cout << var << endl;
         #endif
         node = variables[GlobalVar->getName().str()];
@@ -1263,7 +2463,9 @@ SharedAbstractNode Translator::LiftInstructionsDFS(Value* value, map<Value*, Sha
           }
         }
         // Add the ITE node
-        node = this->FixICmpBehavior(node);
+        if (node != nullptr) {
+          node = this->FixICmpBehavior(node);
+        }
       } break;
       case llvm::Instruction::Select: {
         // Fetch the operands
@@ -1290,6 +2492,17 @@ SharedAbstractNode Translator::LiftInstructionsDFS(Value* value, map<Value*, Sha
         // Create the node
         node = Ctx->ite(n0, n1, n2);
       } break;
+      case llvm::Instruction::Call: {
+        // The references kept as calls are lifted back as references
+        auto* Callee = cast<CallInst>(Inst)->getCalledFunction();
+        if (Callee && Callee->getName().startswith("ref")) {
+          auto Id = stoull(Callee->getName().substr(3).str());
+          node = Ctx->reference(this->Api.getSymbolicExpression(Id));
+        } else {
+          cout << "Unsupported call: ";
+          value->dump();
+        }
+      } break;
       default: {
         cout << "Unsupported instruction type: ";
         value->dump();
@@ -1299,6 +2512,26 @@ SharedAbstractNode Translator::LiftInstructionsDFS(Value* value, map<Value*, Sha
     cout << "Unexpected Value: ";
     value->dump();
   }
+  // Unwind to the caller, the users of the value can't be lifted either
+  if (node == nullptr) {
+    this->Status = TranslationStatus::Unsupported;
+    throw UnsupportedValue();
+  }
+  // Narrow the value to its unknown bits if requested
+  if (this->Demanded && node != nullptr) {
+    auto* Inst = dyn_cast<llvm::Instruction>(value);
+    if (Inst && Inst->getType()->isIntegerTy() && !isa<LoadInst>(Inst)) {
+      node = this->NarrowValue(Inst, node);
+    }
+  }
+  // Keep the output linear in the size of the block: a value used more than once becomes
+  // a symbolic expression, referenced by each user (the variables are already leaves)
+  if (this->Options.SharedValuesAsReferences && node != nullptr) {
+    auto* Inst = dyn_cast<llvm::Instruction>(value);
+    if (Inst && Inst->hasNUsesOrMore(2) && !isa<LoadInst>(Inst) && !isa<CallInst>(Inst)) {
+      node = Ctx->reference(this->Api.newSymbolicExpression(node, "Shared LLVM-IR value"));
+    }
+  }
   // DEBUG: dump the value
 #ifdef VERBOSE_OUTPUT
   cout << "Original value: " << endl;
@@ -1330,7 +2563,7 @@ BasicBlock* Translator::FixBSWAPIntrinsic(BasicBlock* BB) {
           // Get the bswapped value
           auto V = C->getOperand(0);
           // Get the operations type
-          auto i64 = Type::getInt64Ty(this->Context);
+          auto i64 = Type::getInt64Ty(BB->getContext());
           // Lower it to standard instructions
           IRBuilder<> IR(C);
           auto i1 = IR.CreateShl(V, ConstantInt::get(i64, 8));
@@ -1358,7 +2591,7 @@ BasicBlock* Translator::FixBSWAPIntrinsic(BasicBlock* BB) {
           // Get the bswapped value
           auto V = C->getOperand(0);
           // Get the operations type
-          auto i32 = Type::getInt32Ty(this->Context);
+          auto i32 = Type::getInt32Ty(BB->getContext());
           // Lower it to standard instructions
           IRBuilder<> IR(C);
           auto i1 = IR.CreateShl(V, ConstantInt::get(i32, 8));
@@ -1381,7 +2614,7 @@ BasicBlock* Translator::FixBSWAPIntrinsic(BasicBlock* BB) {
           // Get the bswapped value
           auto V = C->getOperand(0);
           // Get the operations type
-          auto i16 = Type::getInt16Ty(this->Context);
+          auto i16 = Type::getInt16Ty(BB->getContext());
           // Lower it to standard instructions
           IRBuilder<> IR(C);
           auto i1 = IR.CreateShl(V, ConstantInt::get(i16, 8));
@@ -1473,27 +2706,1473 @@ SharedAbstractNode Translator::LLVMIRToTritonAst(const shared_ptr<llvm::Module>&
     cout << "Sorry but the provided llvm::Module doesn't contain a function named 'TritonAstFunction'" << endl;
     return nullptr;
   }
-  // Get our lovely basic block out of the function
-  auto& TritonAstBlock = TritonAstFunction->getEntryBlock();
-  // Fix the bswap intrinsics
-  auto* TritonAstBB = this->FixBSWAPIntrinsic(&TritonAstBlock);
-  // Get the return value of the function
-  auto* ReturnValue = TritonAstBB->getTerminator();
-  // Explore the function in a bottom-up fashion
-  map<Value*, SharedAbstractNode> Values;
-  auto Ast = this->LiftInstructionsDFS(ReturnValue, Values, Variables);
-  // Fix the ICmp behavior if needed
-  if (IsITE) {
-    Ast = this->FixICmpBehavior(Ast);
-  }
-  // Undo the ICmp behavior if needed
-  if (IsLogical) {
-    Ast = this->UndoICmpBehavior(Ast);
+  // Resolve the variables lifted as arguments only once
+  this->ArgumentNodes.clear();
+  for (auto& Arg : TritonAstFunction->args()) {
+    this->ArgumentNodes.push_back(Variables[Arg.getName().str()]);
   }
-  // DEBUG: dump the lifted AST
-#ifdef DEBUG_OUTPUT
-  cout << "\nRecovered Triton AST: " << Ast << endl;
-#endif
-  // Return the generated AST
-  return Ast;
-}
\ No newline at end of file
+  return this->LiftTritonAstFunction(TritonAstFunction, Variables, IsITE, IsLogical);
+}
+
+/*
+  Public function to execute the LLVM-IR Module to Triton AST translation, resolving the
+  arguments of TritonAstFunction by their index (see GetVariableArguments).
+*/
+
+SharedAbstractNode Translator::LLVMIRToTritonAst(const shared_ptr<llvm::Module>& Module, const vector<SharedAbstractNode>& Arguments, bool IsITE, bool IsLogical) {
+  // Get our lovely function out of the Module
+  auto* TritonAstFunction = Module->getFunction("TritonAstFunction");
+  if (TritonAstFunction == nullptr) {
+    cout << "Sorry but the provided llvm::Module doesn't contain a function named 'TritonAstFunction'" << endl;
+    return nullptr;
+  }
+  if (Arguments.size() != TritonAstFunction->arg_size()) {
+    cout << "LLVMIRToTritonAst: expected " << TritonAstFunction->arg_size() << " arguments, got " << Arguments.size() << endl;
+    return nullptr;
+  }
+  // No variable is loaded from a global when all of them are arguments
+  map<string, SharedAbstractNode> Variables;
+  this->ArgumentNodes = Arguments;
+  return this->LiftTritonAstFunction(TritonAstFunction, Variables, IsITE, IsLogical);
+}
+
+/*
+  Function to get the fields of the structure returned by TritonAstFunction (as generated
+  by TritonAstsToLLVMIR), after lowering the bswap intrinsics.
+*/
+
+bool Translator::CollectFields(Function* TritonAstFunction, vector<Value*>& Fields) {
+  auto* ReturnType = cast<StructType>(TritonAstFunction->getReturnType());
+  // Get our lovely basic block out of the function
+  auto* TritonAstBB = this->FixBSWAPIntrinsic(&TritonAstFunction->getEntryBlock());
+  auto* Aggregate = cast<ReturnInst>(TritonAstBB->getTerminator())->getReturnValue();
+  // Walk the chain of insertions (the last insertion of a field wins)
+  Fields.assign(ReturnType->getNumElements(), nullptr);
+  while (auto* Insert = dyn_cast<InsertValueInst>(Aggregate)) {
+    auto Index = Insert->getIndices()[0];
+    if (Fields[Index] == nullptr) {
+      Fields[Index] = Insert->getInsertedValueOperand();
+    }
+    Aggregate = Insert->getAggregateOperand();
+  }
+  // The remaining fields are folded in the constant aggregate
+  for (unsigned i = 0; i < Fields.size(); i++) {
+    if (Fields[i] == nullptr) {
+      auto* Constant = dyn_cast<llvm::Constant>(Aggregate);
+      if (Constant == nullptr) {
+        cout << "CollectFields: unexpected aggregate: ";
+        Aggregate->dump();
+        return false;
+      }
+      Fields[i] = Constant->getAggregateElement(i);
+    }
+  }
+  return true;
+}
+
+/*
+  Public function to execute the LLVM-IR Module to Triton ASTs translation of a Module
+  generated by TritonAstsToLLVMIR (a Triton AST for each field of the returned structure).
+*/
+
+vector<SharedAbstractNode> Translator::LLVMIRToTritonAsts(const shared_ptr<llvm::Module>& Module, map<string, SharedAbstractNode>& Variables, bool IsITE, bool IsLogical) {
+  vector<SharedAbstractNode> Asts;
+  // Get our lovely function out of the Module
+  auto* TritonAstFunction = Module->getFunction("TritonAstFunction");
+  if (TritonAstFunction == nullptr) {
+    cout << "Sorry but the provided llvm::Module doesn't contain a function named 'TritonAstFunction'" << endl;
+    return Asts;
+  }
+  auto* ReturnType = dyn_cast<StructType>(TritonAstFunction->getReturnType());
+  if (ReturnType == nullptr) {
+    cout << "LLVMIRToTritonAsts: TritonAstFunction doesn't return a structure" << endl;
+    return Asts;
+  }
+  // Resolve the variables lifted as arguments only once
+  this->ArgumentNodes.clear();
+  for (auto& Arg : TritonAstFunction->args()) {
+    this->ArgumentNodes.push_back(Variables[Arg.getName().str()]);
+  }
+  // Get the returned fields
+  vector<Value*> Fields;
+  if (!this->CollectFields(TritonAstFunction, Fields)) {
+    return {};
+  }
+  // Explore the function in a bottom-up fashion (sharing the lifted values)
+  map<Value*, SharedAbstractNode> Values;
+  this->PrepareNarrowing(TritonAstFunction);
+  for (auto* Field : Fields) {
+    SharedAbstractNode Ast = nullptr;
+    try {
+      Ast = this->LiftInstructionsDFS(Field, Values, Variables);
+    } catch (const UnsupportedValue&) {
+      cout << "LLVMIRToTritonAsts: unsupported value, nothing lifted" << endl;
+      this->PrepareNarrowing(nullptr);
+      this->Provenance.clear();
+      return {};
+    }
+    // Fix the ICmp behavior if needed
+    if (IsITE) {
+      Ast = this->FixICmpBehavior(Ast);
+    }
+    // Undo the ICmp behavior if needed
+    if (IsLogical) {
+      Ast = this->UndoICmpBehavior(Ast);
+    }
+    Asts.push_back(Ast);
+  }
+  this->PrepareNarrowing(nullptr);
+  this->Provenance.clear();
+  return Asts;
+}
+
+/*
+  Public function to simplify a path constraint (the conjunction of the predicates). All
+  the predicates are lifted as 'i1' fields of the same block, sharing their nodes, and
+  optimized together. Then the conjunctions are split, the predicates folded to true or
+  already seen are dropped, and so are the ones implied by another predicate. The
+  result is a list of logical ASTs, empty if every predicate is trivially true (check
+  GetStatus for the failures), or a single false predicate if the path is infeasible.
+  If the optimized block can't be lifted back, the original predicates are returned.
+*/
+
+vector<SharedAbstractNode> Translator::SimplifyPathConstraints(const vector<SharedAbstractNode>& Predicates, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, ssize_t MaxDepth) {
+  using namespace llvm::PatternMatch;
+  // Fetch the AST context
+  auto Ctx = this->Api.getAstContext();
+  auto Infeasible = vector<SharedAbstractNode>{ Ctx->equal(Ctx->bvfalse(), Ctx->bvtrue()) };
+  // The predicates must be logical (or 1-bit bitvectors)
+  vector<SharedAbstractNode> Roots;
+  for (auto& Predicate : Predicates) {
+    auto Root = this->ConvertToLogical(Predicate);
+    if (!Root->isLogical()) {
+      cout << "SimplifyPathConstraints: not a predicate: " << Predicate << endl;
+      this->Status = TranslationStatus::Unsupported;
+      return {};
+    }
+    Roots.push_back(Root);
+  }
+  this->Status = TranslationStatus::Success;
+  if (Roots.empty()) {
+    return {};
+  }
+  // Lift and optimize all the predicates together
+  auto Module = this->TritonAstsToLLVMIR(Roots, Cache, MaxDepth);
+  if (Module == nullptr) {
+    return {};
+  }
+  // Restore the sub-trees cut at the maximum depth
+  auto LiftVariables = Variables;
+  for (auto& FakeVar : this->FakeVars) {
+    LiftVariables[FakeVar.first] = FakeVar.second;
+  }
+  auto* TritonAstFunction = Module->getFunction("TritonAstFunction");
+  vector<Value*> Fields;
+  if (!this->CollectFields(TritonAstFunction, Fields)) {
+    this->Status = TranslationStatus::Failed;
+    return {};
+  }
+  // Split the conjunctions, dropping the true and the duplicated predicates
+  vector<Value*> Conjuncts;
+  set<Value*> Seen;
+  for (auto* Field : Fields) {
+    vector<Value*> Worklist = { Field };
+    while (!Worklist.empty()) {
+      auto* Curr = Worklist.back();
+      Worklist.pop_back();
+      Value* LHS = nullptr;
+      Value* RHS = nullptr;
+      if (match(Curr, m_And(m_Value(LHS), m_Value(RHS))) || match(Curr, m_Select(m_Value(LHS), m_Value(RHS), m_Zero()))) {
+        Worklist.push_back(RHS);
+        Worklist.push_back(LHS);
+      } else if (auto* Constant = dyn_cast<ConstantInt>(Curr)) {
+        if (Constant->isZero()) {
+          return Infeasible;
+        }
+      } else if (Seen.insert(Curr).second) {
+        Conjuncts.push_back(Curr);
+      }
+    }
+  }
+  // Drop the predicates implied by an earlier one
+  auto& DL = Module->getDataLayout();
+  vector<Value*> Kept;
+  for (auto* Conjunct : Conjuncts) {
+    bool Redundant = false;
+    for (auto* Previous : Kept) {
+      auto Implied = isImpliedCondition(Previous, Conjunct, DL);
+      if (Implied.hasValue() && !Implied.getValue()) {
+        return Infeasible;
+      }
+      if (Implied.hasValue()) {
+        Redundant = true;
+        break;
+      }
+    }
+    if (!Redundant) {
+      Kept.push_back(Conjunct);
+    }
+  }
+  // Drop the predicates implied by a later one (one of the equivalent ones survives)
+  for (size_t i = 0; i < Kept.size();) {
+    bool Redundant = false;
+    for (size_t j = 0; j < Kept.size() && !Redundant; j++) {
+      if (i != j) {
+        auto Implied = isImpliedCondition(Kept[j], Kept[i], DL);
+        Redundant = Implied.hasValue() && Implied.getValue();
+      }
+    }
+    if (Redundant) {
+      Kept.erase(Kept.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  // Resolve the variables lifted as arguments only once
+  this->ArgumentNodes.clear();
+  for (auto& Arg : TritonAstFunction->args()) {
+    this->ArgumentNodes.push_back(LiftVariables[Arg.getName().str()]);
+  }
+  // Lift the remaining predicates back (sharing the lifted values)
+  vector<SharedAbstractNode> Simplified;
+  map<Value*, SharedAbstractNode> Values;
+  this->PrepareNarrowing(TritonAstFunction);
+  for (auto* Conjunct : Kept) {
+    SharedAbstractNode Ast = nullptr;
+    try {
+      Ast = this->LiftInstructionsDFS(Conjunct, Values, LiftVariables);
+    } catch (const UnsupportedValue&) {
+      cout << "SimplifyPathConstraints: unsupported value, nothing lifted" << endl;
+      this->PrepareNarrowing(nullptr);
+      this->Provenance.clear();
+      return Predicates;
+    }
+    Simplified.push_back(this->ConvertToLogical(this->UndoICmpBehavior(Ast)));
+  }
+  this->PrepareNarrowing(nullptr);
+  this->Provenance.clear();
+  return Simplified;
+}
+
+/*
+  Public function to get the names of the variables lifted as arguments, in the order of
+  the arguments of TritonAstFunction.
+*/
+
+vector<string> Translator::GetVariableArguments(const shared_ptr<llvm::Module>& Module) const {
+  vector<string> Names;
+  auto* TritonAstFunction = Module->getFunction("TritonAstFunction");
+  if (TritonAstFunction) {
+    for (auto& Arg : TritonAstFunction->args()) {
+      Names.push_back(Arg.getName().str());
+    }
+  }
+  return Names;
+}
+
+/*
+  Function to lift the body of TritonAstFunction to a Triton AST.
+*/
+
+SharedAbstractNode Translator::LiftTritonAstFunction(Function* TritonAstFunction, map<string, SharedAbstractNode>& Variables, bool IsITE, bool IsLogical) {
+  // Get our lovely basic block out of the function
+  auto& TritonAstBlock = TritonAstFunction->getEntryBlock();
+  // Fix the bswap intrinsics
+  auto* TritonAstBB = this->FixBSWAPIntrinsic(&TritonAstBlock);
+  // Get the return value of the function
+  auto* ReturnValue = TritonAstBB->getTerminator();
+  // Explore the function in a bottom-up fashion
+  map<Value*, SharedAbstractNode> Values;
+  this->PrepareNarrowing(TritonAstFunction);
+  SharedAbstractNode Ast = nullptr;
+  try {
+    Ast = this->LiftInstructionsDFS(ReturnValue, Values, Variables);
+  } catch (const UnsupportedValue&) {
+    cout << "LLVMIRToTritonAst: unsupported value, nothing lifted" << endl;
+    this->PrepareNarrowing(nullptr);
+    this->Provenance.clear();
+    return nullptr;
+  }
+  this->PrepareNarrowing(nullptr);
+  this->Provenance.clear();
+  // Fix the ICmp behavior if needed
+  if (IsITE) {
+    Ast = this->FixICmpBehavior(Ast);
+  }
+  // Undo the ICmp behavior if needed
+  if (IsLogical) {
+    Ast = this->UndoICmpBehavior(Ast);
+  }
+  // DEBUG: dump the lifted AST
+#ifdef DEBUG_OUTPUT
+  cout << "\nRecovered Triton AST: " << Ast << endl;
+#endif
+  // Return the generated AST
+  return Ast;
+}
+
+/*
+  Function to print a value of TritonAstFunction as a SMT-LIB2 term. The comparisons are
+  Bool terms and everything else is a bitvector, so a value is converted only when it's
+  used with the other sort (i.e. a 'select' on a 'i1' or a 'zext' of a comparison).
+*/
+
+bool Translator::EmitSMTLIB(Value* V, bool AsBoolean, ostream& Out, const map<Value*, string>& Bound, map<string, SharedAbstractNode>& Variables) {
+  // Convert between the Bool and the (_ BitVec 1) sorts if needed
+  bool IsBoolean = isa<ICmpInst>(V);
+  if (AsBoolean != IsBoolean) {
+    Out << (AsBoolean ? "(= " : "(ite ");
+    if (!this->EmitSMTLIB(V, IsBoolean, Out, Bound, Variables)) {
+      return false;
+    }
+    Out << (AsBoolean ? " #b1)" : " #b1 #b0)");
+    return true;
+  }
+  // Shared values are printed by name
+  auto Name = Bound.find(V);
+  if (Name != Bound.end()) {
+    Out << Name->second;
+    return true;
+  }
+  // Print a variable by the name of its global variable (or argument)
+  auto EmitVariable = [&](const string& Name) {
+    auto Variable = Variables.find(Name);
+    if (Variable == Variables.end() || Variable->second == nullptr) {
+      cout << "EmitSMTLIB: unknown variable " << Name << endl;
+      return false;
+    }
+    Out << Variable->second;
+    return true;
+  };
+  // Print an operation with its operands
+  auto EmitOperation = [&](const string& Operation, Instruction* Inst, bool OperandsAsBoolean) {
+    Out << "(" << Operation;
+    for (auto& Operand : Inst->operands()) {
+      Out << " ";
+      if (!this->EmitSMTLIB(Operand.get(), OperandsAsBoolean, Out, Bound, Variables)) {
+        return false;
+      }
+    }
+    Out << ")";
+    return true;
+  };
+  if (isa<UndefValue>(V)) {
+    // Same choice of LiftInstructionsDFS, a null bitvector
+    Out << "(_ bv0 " << dec << V->getType()->getIntegerBitWidth() << ")";
+    return true;
+  } else if (auto* CI = dyn_cast<ConstantInt>(V)) {
+    const auto& Val = CI->getValue();
+    Out << "(_ bv" << Val.toString(10, false) << " " << dec << Val.getBitWidth() << ")";
+    return true;
+  } else if (auto* Arg = dyn_cast<Argument>(V)) {
+    return EmitVariable(Arg->getName().str());
+  }
+  auto* Inst = dyn_cast<llvm::Instruction>(V);
+  if (Inst == nullptr) {
+    cout << "EmitSMTLIB: unexpected Value: ";
+    V->dump();
+    return false;
+  }
+  // Binary operations with the same semantic in LLVM-IR and SMT-LIB2
+  static const map<unsigned, string> BinaryOps = {
+    { llvm::Instruction::Add, "bvadd" },
+    { llvm::Instruction::Sub, "bvsub" },
+    { llvm::Instruction::Mul, "bvmul" },
+    { llvm::Instruction::UDiv, "bvudiv" },
+    { llvm::Instruction::SDiv, "bvsdiv" },
+    { llvm::Instruction::URem, "bvurem" },
+    { llvm::Instruction::SRem, "bvsrem" },
+    { llvm::Instruction::Shl, "bvshl" },
+    { llvm::Instruction::AShr, "bvashr" },
+    { llvm::Instruction::LShr, "bvlshr" },
+    { llvm::Instruction::And, "bvand" },
+    { llvm::Instruction::Or, "bvor" },
+    { llvm::Instruction::Xor, "bvxor" },
+  };
+  auto Binary = BinaryOps.find(Inst->getOpcode());
+  if (Binary != BinaryOps.end()) {
+    return EmitOperation(Binary->second, Inst, false);
+  }
+  switch (Inst->getOpcode()) {
+    case llvm::Instruction::Load: {
+      return EmitVariable(Inst->getOperand(0)->getName().str());
+    }
+    case llvm::Instruction::ZExt:
+    case llvm::Instruction::SExt: {
+      // Compute the extension size
+      auto dsz = Inst->getType()->getIntegerBitWidth();
+      auto ssz = Inst->getOperand(0)->getType()->getIntegerBitWidth();
+      stringstream ss;
+      ss << "(_ " << (Inst->getOpcode() == llvm::Instruction::ZExt ? "zero_extend " : "sign_extend ") << dec << (dsz - ssz) << ")";
+      return EmitOperation(ss.str(), Inst, false);
+    }
+    case llvm::Instruction::Trunc: {
+      stringstream ss;
+      ss << "(_ extract " << dec << (Inst->getType()->getIntegerBitWidth() - 1) << " 0)";
+      return EmitOperation(ss.str(), Inst, false);
+    }
+    case llvm::Instruction::ICmp: {
+      static const map<CmpInst::Predicate, string> Predicates = {
+        { ICmpInst::ICMP_EQ, "=" },
+        { ICmpInst::ICMP_NE, "distinct" },
+        { ICmpInst::ICMP_UGE, "bvuge" },
+        { ICmpInst::ICMP_UGT, "bvugt" },
+        { ICmpInst::ICMP_ULE, "bvule" },
+        { ICmpInst::ICMP_ULT, "bvult" },
+        { ICmpInst::ICMP_SGE, "bvsge" },
+        { ICmpInst::ICMP_SGT, "bvsgt" },
+        { ICmpInst::ICMP_SLE, "bvsle" },
+        { ICmpInst::ICMP_SLT, "bvslt" },
+      };
+      auto Predicate = Predicates.find(cast<ICmpInst>(Inst)->getPredicate());
+      if (Predicate == Predicates.end()) {
+        cout << "EmitSMTLIB: unsupported ICmpInst: ";
+        Inst->dump();
+        this->Status = TranslationStatus::Unsupported;
+        return false;
+      }
+      return EmitOperation(Predicate->second, Inst, false);
+    }
+    case llvm::Instruction::Select: {
+      // The condition is a Bool term
+      Out << "(ite ";
+      if (!this->EmitSMTLIB(Inst->getOperand(0), true, Out, Bound, Variables)) {
+        return false;
+      }
+      for (unsigned i = 1; i < 3; i++) {
+        Out << " ";
+        if (!this->EmitSMTLIB(Inst->getOperand(i), false, Out, Bound, Variables)) {
+          return false;
+        }
+      }
+      Out << ")";
+      return true;
+    }
+    default: {
+      cout << "EmitSMTLIB: unsupported instruction type: ";
+      Inst->dump();
+      this->Status = TranslationStatus::Unsupported;
+      return false;
+    }
+  }
+}
+
+/*
+  Public function to print the body of TritonAstFunction as a SMT-LIB2 term, skipping the
+  Triton AST rebuild when the result goes straight to a solver. The instructions with
+  multiple uses are bound by a 'let', grouped by depth (a group only uses the names of
+  the enclosing ones), so the text is linear in the number of instructions.
+*/
+
+string Translator::LLVMIRToSMTLIB(const shared_ptr<llvm::Module>& Module, map<string, SharedAbstractNode>& Variables, bool IsLogical) {
+  // Get our lovely function out of the Module
+  auto* TritonAstFunction = Module->getFunction("TritonAstFunction");
+  if (TritonAstFunction == nullptr) {
+    cout << "Sorry but the provided llvm::Module doesn't contain a function named 'TritonAstFunction'" << endl;
+    return "";
+  }
+  if (!TritonAstFunction->getReturnType()->isIntegerTy()) {
+    cout << "LLVMIRToSMTLIB: TritonAstFunction doesn't return an integer" << endl;
+    return "";
+  }
+  // Fix the bswap intrinsics
+  auto* TritonAstBB = this->FixBSWAPIntrinsic(&TritonAstFunction->getEntryBlock());
+  // Find the shared instructions and the depth of their 'let' group
+  set<Value*> Shared;
+  map<Value*, size_t> Depths;
+  vector<vector<Instruction*>> Groups;
+  for (auto& I : *TritonAstBB) {
+    if (isa<ReturnInst>(&I) || I.use_empty()) {
+      continue;
+    }
+    size_t Depth = 0;
+    for (auto& Operand : I.operands()) {
+      auto It = Depths.find(Operand.get());
+      if (It != Depths.end()) {
+        Depth = std::max(Depth, Shared.count(Operand.get()) ? It->second + 1 : It->second);
+      }
+    }
+    Depths[&I] = Depth;
+    // The variables are already printed by name
+    if (I.hasNUsesOrMore(2) && !isa<LoadInst>(&I)) {
+      Shared.insert(&I);
+      if (Groups.size() <= Depth) {
+        Groups.resize(Depth + 1);
+      }
+      Groups[Depth].push_back(&I);
+    }
+  }
+  // Print the 'let' groups, naming the values of a group once all of them are printed
+  stringstream Out;
+  map<Value*, string> Bound;
+  for (auto& Group : Groups) {
+    Out << "(let (";
+    for (size_t i = 0; i < Group.size(); i++) {
+      Out << (i ? " (" : "(") << "t!" << dec << (Bound.size() + i) << " ";
+      if (!this->EmitSMTLIB(Group[i], isa<ICmpInst>(Group[i]), Out, Bound, Variables)) {
+        return "";
+      }
+      Out << ")";
+    }
+    Out << ") ";
+    for (auto* I : Group) {
+      Bound[I] = "t!" + to_string(Bound.size());
+    }
+  }
+  // Print the returned value
+  auto* ReturnValue = cast<ReturnInst>(TritonAstBB->getTerminator())->getReturnValue();
+  bool AsBoolean = IsLogical && ReturnValue->getType()->getIntegerBitWidth() == 1;
+  if (!this->EmitSMTLIB(ReturnValue, AsBoolean, Out, Bound, Variables)) {
+    return "";
+  }
+  Out << string(Groups.size(), ')');
+  return Out.str();
+}
+
+/*
+  Public function to simplify a Triton AST within the given limits, printing the optimized
+  block straight to SMT-LIB2. As with Simplify, Result is the original AST (printed) when
+  the translation fails.
+*/
+
+TranslationStatus Translator::SimplifyToSMTLIB(const SharedAbstractNode& Node, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, string& Result, const TranslationLimits& Limits, ssize_t MaxDepth) {
+  // Keep the original AST unless the translation succeeds
+  stringstream ss;
+  ss << Node;
+  Result = ss.str();
+  // Translate with the given limits
+  auto PreviousLimits = this->Limits;
+  this->Limits = Limits;
+  auto Module = this->TritonAstToLLVMIR(Node, Cache, MaxDepth);
+  this->Limits = PreviousLimits;
+  if (Module == nullptr) {
+    return this->Status;
+  }
+  // Restore the sub-trees cut at the maximum depth
+  auto LiftVariables = Variables;
+  for (auto& FakeVar : this->FakeVars) {
+    LiftVariables[FakeVar.first] = FakeVar.second;
+  }
+  // Print the optimized block (of the same kind)
+  auto Simplified = this->LLVMIRToSMTLIB(Module, LiftVariables, Node->isLogical());
+  if (Simplified.empty()) {
+    if (this->Status == TranslationStatus::Success) {
+      this->Status = TranslationStatus::Failed;
+    }
+    return this->Status;
+  }
+  Result = Simplified;
+  return this->Status;
+}
+
+/*
+  Function to classify an AST as a linear MBA expression: a linear combination (with
+  constant coefficients) of bitwise expressions over the same variables.
+*/
+
+const MBAShape& Translator::ClassifyMBA(const SharedAbstractNode& Node, map<AbstractNode*, MBAShape>& Shapes) {
+  // Check if it's a known node -> shape
+  auto Known = Shapes.find(Node.get());
+  if (Known != Shapes.end()) {
+    return Known->second;
+  }
+  MBAShape Shape;
+  auto Children = Node->getChildren();
+  if (Node->isLogical() || Node->getType() == ast_e::INTEGER_NODE) {
+    // Not a bitvector
+  } else if (!Node->isSymbolized()) {
+    // Constants are linear, the bitwise ones are 0 and -1
+    auto Value = Node->evaluate();
+    Shape.Linear = true;
+    Shape.Bitwise = (Value == 0 || Value == ((triton::uint512(1) << Node->getBitvectorSize()) - 1));
+  } else {
+    switch (Node->getType()) {
+      case ast_e::VARIABLE_NODE: {
+        auto* VarNode = static_cast<VariableNode*>(Node.get());
+        Shape.Linear = true;
+        Shape.Bitwise = true;
+        Shape.Variables[VarNode->getSymbolicVariable()->getName()] = Node;
+      } break;
+      case ast_e::BVNOT_NODE: {
+        // ~e is bitwise if e is, and linear anyway (-e - 1)
+        Shape = this->ClassifyMBA(Children[0], Shapes);
+      } break;
+      case ast_e::BVNEG_NODE: {
+        Shape = this->ClassifyMBA(Children[0], Shapes);
+        Shape.Bitwise = false;
+      } break;
+      case ast_e::BVAND_NODE:
+      case ast_e::BVOR_NODE:
+      case ast_e::BVXOR_NODE:
+      case ast_e::BVNAND_NODE:
+      case ast_e::BVNOR_NODE:
+      case ast_e::BVXNOR_NODE: {
+        auto& LHS = this->ClassifyMBA(Children[0], Shapes);
+        auto& RHS = this->ClassifyMBA(Children[1], Shapes);
+        if (LHS.Bitwise && RHS.Bitwise) {
+          Shape.Linear = true;
+          Shape.Bitwise = true;
+          Shape.Variables = LHS.Variables;
+          Shape.Variables.insert(RHS.Variables.begin(), RHS.Variables.end());
+        }
+      } break;
+      case ast_e::BVADD_NODE:
+      case ast_e::BVSUB_NODE: {
+        auto& LHS = this->ClassifyMBA(Children[0], Shapes);
+        auto& RHS = this->ClassifyMBA(Children[1], Shapes);
+        if (LHS.Linear && RHS.Linear) {
+          Shape.Linear = true;
+          Shape.Variables = LHS.Variables;
+          Shape.Variables.insert(RHS.Variables.begin(), RHS.Variables.end());
+        }
+      } break;
+      case ast_e::BVMUL_NODE: {
+        // Only the multiplications by a constant are linear
+        if (!Children[0]->isSymbolized()) {
+          Shape = this->ClassifyMBA(Children[1], Shapes);
+        } else if (!Children[1]->isSymbolized()) {
+          Shape = this->ClassifyMBA(Children[0], Shapes);
+        }
+        Shape.Bitwise = false;
+      } break;
+      default:
+        break;
+    }
+  }
+  // Too many variables for the table
+  if (Shape.Variables.size() > MBATable::MaxVariables) {
+    Shape = MBAShape();
+  }
+  // Save the shape in the dictionary
+  return Shapes[Node.get()] = Shape;
+}
+
+/*
+  Function to evaluate a linear MBA expression on the boolean corners of its variables:
+  in the corner 'v' the variable 'j' is 0 or -1 depending on the bit 'j' of 'v'.
+*/
+
+const vector<uint64_t>& Translator::EvaluateMBA(const SharedAbstractNode& Node, const vector<string>& Names, map<AbstractNode*, vector<uint64_t>>& Values) {
+  // Check if it's a known node -> values
+  auto Known = Values.find(Node.get());
+  if (Known != Values.end()) {
+    return Known->second;
+  }
+  uint64_t Corners = 1ULL << Names.size();
+  uint64_t Size = Node->getBitvectorSize();
+  uint64_t Mask = (Size == 64) ? ~0ULL : ((1ULL << Size) - 1);
+  vector<uint64_t> Result(Corners);
+  auto Children = Node->getChildren();
+  if (!Node->isSymbolized()) {
+    uint64_t Value = (Node->evaluate() & Mask).convert_to<uint64_t>();
+    fill(Result.begin(), Result.end(), Value);
+  } else {
+    // Evaluate the children first
+    vector<const vector<uint64_t>*> Operands;
+    for (auto& Child : Children) {
+      if (Child->getType() != ast_e::INTEGER_NODE) {
+        Operands.push_back(&this->EvaluateMBA(Child, Names, Values));
+      }
+    }
+    for (uint64_t v = 0; v < Corners; v++) {
+      switch (Node->getType()) {
+        case ast_e::VARIABLE_NODE: {
+          auto* VarNode = static_cast<VariableNode*>(Node.get());
+          auto j = find(Names.begin(), Names.end(), VarNode->getSymbolicVariable()->getName()) - Names.begin();
+          Result[v] = ((v >> j) & 1) ? Mask : 0;
+        } break;
+        case ast_e::BVNOT_NODE: Result[v] = ~(*Operands[0])[v]; break;
+        case ast_e::BVNEG_NODE: Result[v] = -(*Operands[0])[v]; break;
+        case ast_e::BVAND_NODE: Result[v] = (*Operands[0])[v] & (*Operands[1])[v]; break;
+        case ast_e::BVOR_NODE: Result[v] = (*Operands[0])[v] | (*Operands[1])[v]; break;
+        case ast_e::BVXOR_NODE: Result[v] = (*Operands[0])[v] ^ (*Operands[1])[v]; break;
+        case ast_e::BVNAND_NODE: Result[v] = ~((*Operands[0])[v] & (*Operands[1])[v]); break;
+        case ast_e::BVNOR_NODE: Result[v] = ~((*Operands[0])[v] | (*Operands[1])[v]); break;
+        case ast_e::BVXNOR_NODE: Result[v] = ~((*Operands[0])[v] ^ (*Operands[1])[v]); break;
+        case ast_e::BVADD_NODE: Result[v] = (*Operands[0])[v] + (*Operands[1])[v]; break;
+        case ast_e::BVSUB_NODE: Result[v] = (*Operands[0])[v] - (*Operands[1])[v]; break;
+        case ast_e::BVMUL_NODE: Result[v] = (*Operands[0])[v] * (*Operands[1])[v]; break;
+        default: break;
+      }
+      Result[v] &= Mask;
+    }
+  }
+  // Save the values in the dictionary
+  return Values[Node.get()] = Result;
+}
+
+/*
+  Function to build the minimal expression of a bitwise function from the table.
+*/
+
+SharedAbstractNode Translator::BuildBitwise(const MBATable& Table, uint16_t TruthTable, const vector<SharedAbstractNode>& Variables, map<uint16_t, SharedAbstractNode>& Built) {
+  // Share the already built sub-expressions
+  auto Known = Built.find(TruthTable);
+  if (Known != Built.end()) {
+    return Known->second;
+  }
+  auto Ctx = this->Api.getAstContext();
+  auto& Entry = Table.Lookup(TruthTable);
+  SharedAbstractNode Node = nullptr;
+  switch (Entry.Op) {
+    case MBATable::Operation::Variable: {
+      Node = Variables[Entry.Left];
+    } break;
+    case MBATable::Operation::Not: {
+      Node = Ctx->bvnot(this->BuildBitwise(Table, Entry.Left, Variables, Built));
+    } break;
+    case MBATable::Operation::And: {
+      Node = Ctx->bvand(this->BuildBitwise(Table, Entry.Left, Variables, Built), this->BuildBitwise(Table, Entry.Right, Variables, Built));
+    } break;
+    case MBATable::Operation::Or: {
+      Node = Ctx->bvor(this->BuildBitwise(Table, Entry.Left, Variables, Built), this->BuildBitwise(Table, Entry.Right, Variables, Built));
+    } break;
+    case MBATable::Operation::Xor: {
+      Node = Ctx->bvxor(this->BuildBitwise(Table, Entry.Left, Variables, Built), this->BuildBitwise(Table, Entry.Right, Variables, Built));
+    } break;
+    default:
+      return nullptr;
+  }
+  return Built[TruthTable] = Node;
+}
+
+/*
+  Function to build the expression of a linear MBA signature.
+
+  A linear MBA expression e = sum(a_i * f_i(x)) with bitwise f_i is fully described by
+  its signature s(v) = sum(a_i * f_i(v)) on the boolean corners, because on each bit
+  e(x) = sum(2^b * s(bits_b(x))). The signature is matched against three shapes:
+  - a constant (s is the same everywhere);
+  - a scaled bitwise function (s only takes the values 0 and a), looked up in the table;
+  - a linear combination of the variables;
+  where the last two may also have a constant term.
+*/
+
+SharedAbstractNode Translator::BuildMBA(const vector<uint64_t>& Signature, uint32_t Size, const vector<SharedAbstractNode>& Variables) {
+  auto Ctx = this->Api.getAstContext();
+  uint64_t Corners = Signature.size();
+  uint64_t Mask = (Size == 64) ? ~0ULL : ((1ULL << Size) - 1);
+  auto& Table = MBATable::Get(Variables.size());
+  // A constant 'c' has the signature '-c'
+  auto Constant = [&](uint64_t Value) {
+    return Ctx->bv(Value & Mask, Size);
+  };
+  if (all_of(Signature.begin(), Signature.end(), [&](uint64_t Value) { return Value == Signature[0]; })) {
+    return Constant(-Signature[0]);
+  }
+  // Match a signature only taking the values 0 and 'a'
+  auto Scaled = [&](const vector<uint64_t>& S) -> SharedAbstractNode {
+    uint64_t A = 0;
+    uint16_t TruthTable = 0;
+    for (uint64_t v = 0; v < Corners; v++) {
+      if (S[v] == 0) {
+        continue;
+      }
+      if (A != 0 && S[v] != A) {
+        return nullptr;
+      }
+      A = S[v];
+      TruthTable |= 1 << v;
+    }
+    map<uint16_t, SharedAbstractNode> Built;
+    auto F = this->BuildBitwise(Table, TruthTable, Variables, Built);
+    if (A == 0 || F == nullptr) {
+      return nullptr;
+    }
+    if (A == 1) {
+      return F;
+    }
+    if (A == Mask) {
+      return Ctx->bvneg(F);
+    }
+    return Ctx->bvmul(F, Constant(A));
+  };
+  if (auto Node = Scaled(Signature)) {
+    return Node;
+  }
+  // Remove the constant term
+  vector<uint64_t> Rest(Corners);
+  for (uint64_t v = 0; v < Corners; v++) {
+    Rest[v] = (Signature[v] - Signature[0]) & Mask;
+  }
+  auto Node = Scaled(Rest);
+  if (Node == nullptr) {
+    // Match a linear combination of the variables
+    for (uint64_t v = 0; v < Corners; v++) {
+      uint64_t Sum = 0;
+      for (uint64_t j = 0; j < Variables.size(); j++) {
+        if ((v >> j) & 1) {
+          Sum += Rest[1ULL << j];
+        }
+      }
+      if ((Sum & Mask) != Rest[v]) {
+        return nullptr;
+      }
+    }
+    for (uint64_t j = 0; j < Variables.size(); j++) {
+      uint64_t C = Rest[1ULL << j];
+      if (C == 0) {
+        continue;
+      }
+      auto Term = (C == 1 || C == Mask) ? Variables[j] : Ctx->bvmul(Variables[j], Constant(C));
+      if (Node == nullptr) {
+        Node = (C == Mask) ? Ctx->bvneg(Term) : Term;
+      } else {
+        Node = (C == Mask) ? Ctx->bvsub(Node, Term) : Ctx->bvadd(Node, Term);
+      }
+    }
+  }
+  // Add the constant term back (if any)
+  if ((Signature[0] & Mask) == 0) {
+    return Node;
+  }
+  return Ctx->bvadd(Node, Constant(-Signature[0]));
+}
+
+/*
+  Function to look up the minimal equivalent expression of a linear MBA AST. The AST is
+  evaluated on the 2^k boolean corners of its k variables (up to 4) and the resulting
+  signature is matched against the table; the result is used only if it's smaller.
+*/
+
+SharedAbstractNode Translator::LookupMBA(const SharedAbstractNode& Node, map<AbstractNode*, MBAShape>& Shapes, map<SharedAbstractNode, uint64_t>& Sizes) {
+  // Only bitvectors fitting the evaluation can be handled
+  if (Node->isLogical() || Node->getBitvectorSize() > 64 || Node->getType() == ast_e::VARIABLE_NODE) {
+    return nullptr;
+  }
+  auto& Shape = this->ClassifyMBA(Node, Shapes);
+  if (!Shape.Linear || Shape.Variables.empty()) {
+    return nullptr;
+  }
+  // Sort the variables (the names are already sorted by the map)
+  vector<string> Names;
+  vector<SharedAbstractNode> Variables;
+  for (auto& Var : Shape.Variables) {
+    Names.push_back(Var.first);
+    Variables.push_back(Var.second);
+  }
+  // Compute the signature: on the corners the expression is s(v) * (2^n - 1) = -s(v)
+  map<AbstractNode*, vector<uint64_t>> Values;
+  auto Signature = this->EvaluateMBA(Node, Names, Values);
+  uint64_t Size = Node->getBitvectorSize();
+  uint64_t Mask = (Size == 64) ? ~0ULL : ((1ULL << Size) - 1);
+  for (auto& Value : Signature) {
+    Value = -Value & Mask;
+  }
+  // Build the equivalent expression
+  auto Equivalent = this->BuildMBA(Signature, Size, Variables);
+  if (Equivalent == nullptr) {
+    return nullptr;
+  }
+  // Only use it when it's smaller
+  map<SharedAbstractNode, uint64_t> EquivalentSizes;
+  if (this->DetermineASTSize(Equivalent, EquivalentSizes) >= this->DetermineASTSize(Node, Sizes)) {
+    return nullptr;
+  }
+  #ifdef VERBOSE_OUTPUT
+  cout << "LookupMBA: " << Node << " -> " << Equivalent << endl;
+  #endif
+  return Equivalent;
+}
+
+/*
+  Public function to get the minimal equivalent expression of a known MBA shape. When
+  the whole AST is a hit the caller can skip the LLVM round-trip entirely.
+*/
+
+SharedAbstractNode Translator::SimplifyKnownMBA(const SharedAbstractNode& Node) {
+  map<AbstractNode*, MBAShape> Shapes;
+  map<SharedAbstractNode, uint64_t> Sizes;
+  return this->LookupMBA(Node, Shapes, Sizes);
+}
+
+/*
+  Function to get the constant of an assigned variable. The value is truncated to the
+  size of the variable, as Triton does when a variable is concretized.
+*/
+
+ConstantInt* Translator::GetAssignedValue(const uint512& Value, uint32_t Size) {
+  // Truncate the value to the size of the variable
+  uint512 Mask = (uint512(1) << Size) - 1;
+  // Construct the integer from a string (so we can support arbitrarily long bitvectors)
+  stringstream ss;
+  ss << dec << (Value & Mask);
+  return ConstantInt::get(this->Context, APInt(Size, ss.str(), 10));
+}
+
+/*
+  Function to replace the loads of the assigned variables with their value. The cached
+  references linked in the Module still load the variables, so they are specialized
+  here before being inlined; the variables left without loads are removed.
+*/
+
+void Translator::SubstituteAssignment(llvm::Module* M) {
+  // Variables not loaded anymore
+  vector<GlobalVariable*> Unused;
+  for (auto& GVar : M->globals()) {
+    // Skip the variables without a value
+    auto Assigned = this->Assignment.find(GVar.getName().str());
+    auto* Type = dyn_cast<IntegerType>(GVar.getValueType());
+    if (Assigned == this->Assignment.end() || Type == nullptr) {
+      continue;
+    }
+    auto* Value = this->GetAssignedValue(Assigned->second, Type->getBitWidth());
+    // Collect the loads (in any function)
+    vector<LoadInst*> Loads;
+    for (auto* User : GVar.users()) {
+      if (auto* Load = dyn_cast<LoadInst>(User)) {
+        Loads.push_back(Load);
+      }
+    }
+    // Replace them with the value
+    for (auto* Load : Loads) {
+      Load->replaceAllUsesWith(Value);
+      Load->eraseFromParent();
+    }
+    if (GVar.use_empty()) {
+      Unused.push_back(&GVar);
+    }
+  }
+  // Remove the unused variables
+  for (auto* GVar : Unused) {
+    this->VarsValue.erase(GVar->getName().str());
+    GVar->eraseFromParent();
+  }
+}
+
+/*
+  Function to replace the loads of the variables with arguments of TritonAstFunction.
+*/
+
+Function* Translator::PromoteVariablesToArguments(llvm::Module* M) {
+  // Fetch the function to be rewritten
+  auto* OldFun = M->getFunction("TritonAstFunction");
+  // Collect the variables loaded by the function
+  vector<GlobalVariable*> Globals;
+  for (auto& GVar : M->globals()) {
+    for (auto* User : GVar.users()) {
+      auto* Load = dyn_cast<LoadInst>(User);
+      if (Load && Load->getFunction() == OldFun) {
+        Globals.push_back(&GVar);
+        break;
+      }
+    }
+  }
+  // Nothing to do if the function doesn't read any variable
+  if (Globals.empty()) {
+    return OldFun;
+  }
+  // Order the symbolic variables by ID ("SymVar_<id>"), followed by the fake variables by name
+  auto Rank = [](StringRef Name) {
+    uint64_t Id = UINT64_MAX;
+    if (Name.startswith("SymVar_") && Name.substr(7).getAsInteger(10, Id)) {
+      Id = UINT64_MAX;
+    }
+    return make_pair(Id, Name.str());
+  };
+  // Variables already promoted (e.g. loaded again by an inlined reference) reuse their argument
+  map<string, Argument*> Arguments;
+  for (auto& Arg : OldFun->args()) {
+    Arguments[Arg.getName().str()] = &Arg;
+  }
+  // Merge the already promoted variables with the new ones
+  vector<pair<string, Type*>> Params;
+  for (auto& Arg : OldFun->args()) {
+    Params.push_back({ Arg.getName().str(), Arg.getType() });
+  }
+  for (auto* GVar : Globals) {
+    if (Arguments.find(GVar->getName().str()) == Arguments.end()) {
+      Params.push_back({ GVar->getName().str(), GVar->getValueType() });
+    }
+  }
+  auto* NewFun = OldFun;
+  if (Params.size() != OldFun->arg_size()) {
+    // Rebuild the whole parameter list in order, so it doesn't depend on the promotion rounds
+    std::stable_sort(Params.begin(), Params.end(), [&](const pair<string, Type*>& A, const pair<string, Type*>& B) {
+      return Rank(A.first) < Rank(B.first);
+    });
+    vector<Type*> Types;
+    for (auto& Param : Params) {
+      Types.push_back(Param.second);
+    }
+    // Create the function with the new signature
+    auto* NewType = FunctionType::get(OldFun->getReturnType(), Types, false);
+    NewFun = Function::Create(NewType, OldFun->getLinkage(), "", M);
+    NewFun->copyAttributesFrom(OldFun);
+    // Move the body into the new function
+    NewFun->getBasicBlockList().splice(NewFun->begin(), OldFun->getBasicBlockList());
+    // Name the arguments after their variables and remap the old ones
+    auto NewArg = NewFun->arg_begin();
+    for (auto& Param : Params) {
+      auto OldArg = Arguments.find(Param.first);
+      if (OldArg != Arguments.end()) {
+        OldArg->second->replaceAllUsesWith(&*NewArg);
+      }
+      NewArg->setName(Param.first);
+      Arguments[Param.first] = &*NewArg;
+      NewArg++;
+    }
+    // Replace the old function
+    NewFun->takeName(OldFun);
+    OldFun->eraseFromParent();
+  }
+  // Replace the loads of each variable with its argument
+  for (auto* GVar : Globals) {
+    auto* Arg = Arguments[GVar->getName().str()];
+    vector<LoadInst*> Loads;
+    for (auto* User : GVar->users()) {
+      auto* Load = dyn_cast<LoadInst>(User);
+      if (Load && Load->getFunction() == NewFun) {
+        Loads.push_back(Load);
+      }
+    }
+    for (auto* Load : Loads) {
+      Load->replaceAllUsesWith(Arg);
+      Load->eraseFromParent();
+    }
+  }
+  // Drop the variables which are not used anymore
+  for (auto* GVar : Globals) {
+    if (GVar->use_empty()) {
+      GVar->eraseFromParent();
+    }
+  }
+  return NewFun;
+}
+
+/*
+  Function to optimize a batch kernel for the host target (vectorizers included).
+*/
+
+void Translator::OptimizeKernel(llvm::Module* M, TargetMachine* TM) {
+  // Let the passes know about the target
+  M->setDataLayout(TM->createDataLayout());
+  M->setTargetTriple(TM->getTargetTriple().str());
+  auto PassManager = llvm::legacy::PassManager();
+  PassManager.add(createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
+  PassManagerBuilder Builder;
+  Builder.OptLevel = 3;
+  Builder.SizeLevel = 0;
+  Builder.Inliner = createAlwaysInlinerLegacyPass();
+  Builder.LoopVectorize = true;
+  Builder.SLPVectorize = true;
+  TM->adjustPassManager(Builder);
+  Builder.populateModulePassManager(PassManager);
+  PassManager.run(*M);
+}
+
+/*
+  Public function to compile a Triton AST to a kernel evaluating a batch of assignments.
+
+  The kernel has the following signature:
+
+    void TritonAstBatchFunction(const uint64_t* const* Columns, uint64_t* Output, uint64_t Count)
+
+  where 'Columns' holds one SoA buffer per variable (in the BatchKernel::Variables order)
+  and each iteration of its loop calls the always-inlined scalar TritonAstFunction, so the
+  loop vectorizer can process multiple assignments with the host vector units.
+*/
+
+shared_ptr<BatchKernel> Translator::CompileBatchKernel(const SharedAbstractNode& Node, map<ExpKey, shared_ptr<llvm::Module>>& Cache) {
+  // Initialize the native target only once
+  static std::once_flag NativeTargetInitialized;
+  std::call_once(NativeTargetInitialized, []() {
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    InitializeNativeTargetAsmParser();
+  });
+  // The lanes of the kernel are 64 bits wide
+  if (Node->getBitvectorSize() > 64) {
+    cout << "CompileBatchKernel: bitvectors wider than 64 bits are not supported" << endl;
+    return nullptr;
+  }
+  // Lift and optimize the scalar expression
+  auto Lifted = this->TritonAstToLLVMIR(Node, Cache);
+  if (Lifted == nullptr) {
+    cout << "CompileBatchKernel: translation failed (" << GetStatusName(this->Status) << ")" << endl;
+    return nullptr;
+  }
+  // Work on a copy (the lifted Module is also returned to the callers)
+  unique_ptr<llvm::Module> M = llvm::CloneModule(*Lifted);
+  // Turn the variables into arguments of the scalar function
+  auto* Scalar = this->PromoteVariablesToArguments(M.get());
+  Scalar->setLinkage(GlobalValue::InternalLinkage);
+  // Describe the kernel inputs
+  auto Kernel = make_shared<BatchKernel>();
+  Kernel->BitvectorSize = Node->getBitvectorSize();
+  for (auto& Arg : Scalar->args()) {
+    if (Arg.getType()->getIntegerBitWidth() > 64) {
+      cout << "CompileBatchKernel: variables wider than 64 bits are not supported" << endl;
+      return nullptr;
+    }
+    Kernel->Variables.push_back(Arg.getName().str());
+  }
+  // Create the kernel function
+  auto* I64 = Type::getInt64Ty(this->Context);
+  auto* I64Ptr = PointerType::getUnqual(I64);
+  auto* KernelType = FunctionType::get(Type::getVoidTy(this->Context), { PointerType::getUnqual(I64Ptr), I64Ptr, I64 }, false);
+  auto* KernelFun = Function::Create(KernelType, Function::ExternalLinkage, "TritonAstBatchFunction", M.get());
+  auto* Columns = KernelFun->arg_begin();
+  auto* Output = Columns + 1;
+  auto* Count = Columns + 2;
+  // The output never aliases the inputs
+  KernelFun->addParamAttr(1, Attribute::NoAlias);
+  // Create the kernel blocks
+  auto* EntryBlock = BasicBlock::Create(this->Context, "BatchEntry", KernelFun);
+  auto* LoopBlock = BasicBlock::Create(this->Context, "BatchLoop", KernelFun);
+  auto* ExitBlock = BasicBlock::Create(this->Context, "BatchExit", KernelFun);
+  // Fetch the column pointers once
+  IRBuilder<> IR(EntryBlock);
+  vector<Value*> Bases;
+  for (uint64_t i = 0; i < Kernel->Variables.size(); i++) {
+    auto* Slot = IR.CreateInBoundsGEP(I64Ptr, Columns, IR.getInt64(i));
+    Bases.push_back(IR.CreateLoad(I64Ptr, Slot));
+  }
+  IR.CreateCondBr(IR.CreateICmpEQ(Count, IR.getInt64(0)), ExitBlock, LoopBlock);
+  // Evaluate one assignment per iteration
+  IR.SetInsertPoint(LoopBlock);
+  auto* Index = IR.CreatePHI(I64, 2);
+  Index->addIncoming(IR.getInt64(0), EntryBlock);
+  vector<Value*> Args;
+  auto Param = Scalar->arg_begin();
+  for (auto* Base : Bases) {
+    auto* Lane = IR.CreateLoad(I64, IR.CreateInBoundsGEP(I64, Base, Index));
+    Args.push_back(IR.CreateTrunc(Lane, Param->getType()));
+    Param++;
+  }
+  auto* Result = IR.CreateCall(Scalar, Args);
+  IR.CreateStore(IR.CreateZExt(Result, I64), IR.CreateInBoundsGEP(I64, Output, Index));
+  auto* Next = IR.CreateAdd(Index, IR.getInt64(1), "", true, true);
+  Index->addIncoming(Next, LoopBlock);
+  IR.CreateCondBr(IR.CreateICmpEQ(Next, Count), ExitBlock, LoopBlock);
+  // Leave the kernel
+  IR.SetInsertPoint(ExitBlock);
+  IR.CreateRetVoid();
+  // Collect the host features (e.g. AVX2 or AVX-512)
+  StringMap<bool> HostFeatures;
+  vector<string> Attributes;
+  if (sys::getHostCPUFeatures(HostFeatures)) {
+    for (auto& Feature : HostFeatures) {
+      Attributes.push_back((Feature.second ? "+" : "-") + Feature.first().str());
+    }
+  }
+  // Select the host target
+  string Error;
+  auto* KernelModule = M.get();
+  EngineBuilder Builder(std::move(M));
+  Builder.setEngineKind(EngineKind::JIT)
+         .setErrorStr(&Error)
+         .setOptLevel(CodeGenOpt::Aggressive)
+         .setMCPU(sys::getHostCPUName())
+         .setMAttrs(Attributes);
+  auto* TM = Builder.selectTarget();
+  if (TM == nullptr) {
+    cout << "CompileBatchKernel: failed to select the host target (" << Error << ")" << endl;
+    return nullptr;
+  }
+  // Inline the scalar function and vectorize the loop
+  this->OptimizeKernel(KernelModule, TM);
+#ifdef DEBUG_OUTPUT
+  cout << "\n> Batch kernel LLVM-IR Module\n" << endl;
+  KernelModule->dump();
+#endif
+  // Compile the kernel
+  auto* Engine = Builder.create(TM);
+  if (Engine == nullptr) {
+    cout << "CompileBatchKernel: failed to create the execution engine (" << Error << ")" << endl;
+    return nullptr;
+  }
+  Engine->finalizeObject();
+  Kernel->Engine = shared_ptr<ExecutionEngine>(Engine);
+  Kernel->Function = (BatchFunction)Engine->getFunctionAddress("TritonAstBatchFunction");
+  return Kernel;
+}
+
+/*
+  Public function to evaluate a Triton AST over columns of variable assignments.
+
+  Each column holds the values of a variable (indexed by name, as in the variables map)
+  and all the columns must have the same length; the result holds one value per row.
+  An AST without variables needs no columns: Rows gives the number of rows (at least 1).
+*/
+
+vector<uint64_t> Translator::EvaluateBatch(const SharedAbstractNode& Node, const map<string, vector<uint64_t>>& Columns, map<ExpKey, shared_ptr<llvm::Module>>& Cache, uint64_t Rows) {
+  // Determine the number of assignments
+  uint64_t Count = Columns.empty() ? std::max<uint64_t>(Rows, 1) : Columns.begin()->second.size();
+  if (!Columns.empty() && Rows && Rows != Count) {
+    cout << "EvaluateBatch: the columns don't have " << Rows << " rows" << endl;
+    return {};
+  }
+  for (auto& Column : Columns) {
+    if (Column.second.size() != Count) {
+      cout << "EvaluateBatch: column '" << Column.first << "' has a mismatching length" << endl;
+      return {};
+    }
+  }
+  // Compile the expression
+  auto Kernel = this->CompileBatchKernel(Node, Cache);
+  if (Kernel == nullptr) {
+    return {};
+  }
+  // Sort the columns in the kernel order
+  vector<const uint64_t*> Inputs;
+  for (auto& Name : Kernel->Variables) {
+    auto Column = Columns.find(Name);
+    if (Column == Columns.end()) {
+      cout << "EvaluateBatch: missing column for variable '" << Name << "'" << endl;
+      return {};
+    }
+    Inputs.push_back(Column->second.data());
+  }
+  // Evaluate all the assignments
+  vector<uint64_t> Output(Count);
+  Kernel->Run(Inputs.data(), Output.data(), Count);
+  return Output;
+}
+
+/*
+  Function to collect the variables of an AST (following the references).
+*/
+
+void Translator::CollectVariables(const SharedAbstractNode& Node, map<string, SharedAbstractNode>& Variables, set<AbstractNode*>& Visited) {
+  // Visit the shared nodes only once
+  if (!Visited.insert(Node.get()).second) {
+    return;
+  }
+  switch (Node->getType()) {
+    case ast_e::VARIABLE_NODE: {
+      auto* VarNode = static_cast<VariableNode*>(Node.get());
+      Variables[VarNode->getSymbolicVariable()->getName()] = Node;
+    } break;
+    case ast_e::REFERENCE_NODE: {
+      auto* RefNode = static_cast<ReferenceNode*>(Node.get());
+      this->CollectVariables(RefNode->getSymbolicExpression()->getAst(), Variables, Visited);
+    } break;
+    default: {
+      for (auto& Child : Node->getChildren()) {
+        this->CollectVariables(Child, Variables, Visited);
+      }
+    } break;
+  }
+}
+
+/*
+  Public function to check the equivalence of two ASTs with compiled code.
+
+  Both the ASTs are compiled to batch kernels and evaluated on the combinations of the
+  corner cases of each variable (0, 1, -1, the sign bit and its neighbours, the powers of
+  two) followed by random samples; the samples are split in blocks evaluated by multiple
+  threads. When all the samples agree and a proof is requested, the solver is queried.
+*/
+
+EquivalenceReport Translator::CheckEquivalence(const SharedAbstractNode& Original, const SharedAbstractNode& Simplified, map<ExpKey, shared_ptr<llvm::Module>>& Cache, const EquivalenceOptions& Options) {
+  EquivalenceReport Report;
+  // Collect the variables of both the expressions
+  map<string, SharedAbstractNode> Variables;
+  set<AbstractNode*> Visited;
+  this->CollectVariables(Original, Variables, Visited);
+  this->CollectVariables(Simplified, Variables, Visited);
+  // Compile both the expressions
+  auto OriginalKernel = this->CompileBatchKernel(Original, Cache);
+  auto SimplifiedKernel = this->CompileBatchKernel(Simplified, Cache);
+  if (OriginalKernel == nullptr || SimplifiedKernel == nullptr) {
+    cout << "CheckEquivalence: failed to compile the expressions" << endl;
+    Report.Status = (this->Status != TranslationStatus::Success) ? this->Status : TranslationStatus::Failed;
+    Report.Error = "failed to compile the expressions";
+    Report.Equivalent = false;
+    return Report;
+  }
+  // Assign a dense index to each variable and determine its corner cases
+  vector<string> Names;
+  vector<uint64_t> Masks;
+  vector<vector<uint64_t>> Corners;
+  map<string, size_t> Indexes;
+  for (auto& Var : Variables) {
+    uint64_t Size = Var.second->getBitvectorSize();
+    if (Size > 64) {
+      cout << "CheckEquivalence: variables wider than 64 bits are not supported" << endl;
+      Report.Status = TranslationStatus::Unsupported;
+      Report.Error = "variable " + Var.first + " is wider than 64 bits";
+      Report.Equivalent = false;
+      return Report;
+    }
+    uint64_t Mask = (Size == 64) ? ~0ULL : ((1ULL << Size) - 1);
+    uint64_t Sign = 1ULL << (Size - 1);
+    vector<uint64_t> Values = { 0, 1, Mask, Sign, Sign - 1, Sign + 1, Mask - 1 };
+    for (uint64_t Bit = 1; Bit < Size; Bit++) {
+      Values.push_back(1ULL << Bit);
+    }
+    for (auto& Value : Values) {
+      Value &= Mask;
+    }
+    std::sort(Values.begin(), Values.end());
+    Values.erase(std::unique(Values.begin(), Values.end()), Values.end());
+    Indexes[Var.first] = Names.size();
+    Names.push_back(Var.first);
+    Masks.push_back(Mask);
+    Corners.push_back(Values);
+  }
+  // Map the kernel inputs to the dense indexes
+  vector<size_t> OriginalIndexes, SimplifiedIndexes;
+  auto MapInputs = [&](const BatchKernel& Kernel, vector<size_t>& KernelIndexes) {
+    for (auto& Name : Kernel.Variables) {
+      // A kernel input which isn't a variable of the expressions (e.g. a fake variable)
+      auto Index = Indexes.find(Name);
+      if (Index == Indexes.end()) {
+        cout << "CheckEquivalence: unknown kernel variable " << Name << endl;
+        Report.Error = "unknown kernel variable " + Name;
+        return false;
+      }
+      KernelIndexes.push_back(Index->second);
+    }
+    return true;
+  };
+  if (!MapInputs(*OriginalKernel, OriginalIndexes) || !MapInputs(*SimplifiedKernel, SimplifiedIndexes)) {
+    Report.Status = TranslationStatus::Unsupported;
+    Report.Equivalent = false;
+    return Report;
+  }
+  // Determine the number of corner case combinations (without overflowing)
+  uint64_t CornerRows = 1;
+  for (auto& Values : Corners) {
+    if (CornerRows > Options.CornerSamples / Values.size()) {
+      CornerRows = Options.CornerSamples;
+      break;
+    }
+    CornerRows *= Values.size();
+  }
+  CornerRows = min(CornerRows, Options.CornerSamples);
+  // Split the samples in blocks
+  const uint64_t BlockSize = 4096;
+  uint64_t Total = CornerRows + Options.Samples;
+  uint64_t Blocks = (Total + BlockSize - 1) / BlockSize;
+  atomic<uint64_t> NextBlock(0);
+  atomic<uint64_t> Evaluated(0);
+  atomic<bool> Stop(false);
+  mutex ReportMutex;
+  // Evaluate the blocks until there's nothing left or enough counterexamples are found
+  auto Worker = [&]() {
+    vector<vector<uint64_t>> Columns(Names.size(), vector<uint64_t>(BlockSize));
+    vector<const uint64_t*> OriginalInputs, SimplifiedInputs;
+    for (auto Index : OriginalIndexes) {
+      OriginalInputs.push_back(Columns[Index].data());
+    }
+    for (auto Index : SimplifiedIndexes) {
+      SimplifiedInputs.push_back(Columns[Index].data());
+    }
+    vector<uint64_t> OriginalOutput(BlockSize), SimplifiedOutput(BlockSize);
+    while (!Stop) {
+      uint64_t Block = NextBlock++;
+      if (Block >= Blocks) {
+        break;
+      }
+      uint64_t First = Block * BlockSize;
+      uint64_t Count = min(BlockSize, Total - First);
+      // Each block has its own generator, so the samples don't depend on the scheduling
+      mt19937_64 Random(Options.Seed ^ (Block * 0x9E3779B97F4A7C15ULL));
+      for (uint64_t Row = 0; Row < Count; Row++) {
+        uint64_t Sample = First + Row;
+        if (Sample < CornerRows) {
+          // Enumerate the corner case combinations as a mixed radix counter
+          uint64_t Digits = Sample;
+          for (size_t i = 0; i < Names.size(); i++) {
+            Columns[i][Row] = Corners[i][Digits % Corners[i].size()];
+            Digits /= Corners[i].size();
+          }
+        } else {
+          // Mix uniformly random values with random corner cases
+          for (size_t i = 0; i < Names.size(); i++) {
+            uint64_t Value = Random();
+            if ((Value & 3) == 0) {
+              Columns[i][Row] = Corners[i][(Value >> 2) % Corners[i].size()];
+            } else {
+              Columns[i][Row] = Random() & Masks[i];
+            }
+          }
+        }
+      }
+      // Evaluate both the expressions
+      OriginalKernel->Run(OriginalInputs.data(), OriginalOutput.data(), Count);
+      SimplifiedKernel->Run(SimplifiedInputs.data(), SimplifiedOutput.data(), Count);
+      Evaluated += Count;
+      // Collect the mismatches
+      for (uint64_t Row = 0; Row < Count; Row++) {
+        if (OriginalOutput[Row] == SimplifiedOutput[Row]) {
+          continue;
+        }
+        lock_guard<mutex> Lock(ReportMutex);
+        // Count the mismatch even when there's no room left to store it
+        Report.Mismatches++;
+        if (Report.Counterexamples.size() < Options.MaxCounterexamples) {
+          Counterexample Cex;
+          for (size_t i = 0; i < Names.size(); i++) {
+            Cex.Assignment[Names[i]] = Columns[i][Row];
+          }
+          Cex.Original = OriginalOutput[Row];
+          Cex.Simplified = SimplifiedOutput[Row];
+          Report.Counterexamples.push_back(Cex);
+        }
+        if (Report.Counterexamples.size() >= Options.MaxCounterexamples) {
+          Stop = true;
+          break;
+        }
+      }
+    }
+  };
+  // Run the workers
+  size_t Threads = Options.Threads ? Options.Threads : max(1u, thread::hardware_concurrency());
+  auto Start = chrono::steady_clock::now();
+  vector<thread> Workers;
+  for (size_t i = 0; i < Threads; i++) {
+    Workers.emplace_back(Worker);
+  }
+  for (auto& Worker : Workers) {
+    Worker.join();
+  }
+  chrono::duration<double> Elapsed = chrono::steady_clock::now() - Start;
+  // Fill the report
+  Report.Samples = Evaluated;
+  Report.SamplesPerSecond = (Elapsed.count() > 0) ? (Report.Samples / Elapsed.count()) : 0;
+  Report.Equivalent = (Report.Mismatches == 0);
+  // Escalate to the solver only if requested and all the samples agree
+  if (Report.Equivalent && Options.Prove) {
+    auto Ctx = this->Api.getAstContext();
+    // Only UNSAT is a proof, an empty model is also returned on timeout or unknown
+    triton::engines::solver::status_e SolverStatus = triton::engines::solver::UNKNOWN;
+    auto Model = this->Api.getModel(Ctx->distinct(Original, Simplified), &SolverStatus);
+    if (SolverStatus == triton::engines::solver::UNSAT) {
+      Report.Proved = true;
+    } else if (SolverStatus == triton::engines::solver::SAT && !Model.empty()) {
+      // Evaluate the counterexample found by the solver
+      vector<vector<uint64_t>> Columns(Names.size(), vector<uint64_t>(1, 0));
+      for (auto& Item : Model) {
+        auto Name = this->Api.getSymbolicVariable(Item.first)->getName();
+        if (Indexes.find(Name) != Indexes.end()) {
+          auto Index = Indexes[Name];
+          Columns[Index][0] = (Item.second.getValue() & Masks[Index]).convert_to<uint64_t>();
+        }
+      }
+      vector<const uint64_t*> OriginalInputs, SimplifiedInputs;
+      for (auto Index : OriginalIndexes) {
+        OriginalInputs.push_back(Columns[Index].data());
+      }
+      for (auto Index : SimplifiedIndexes) {
+        SimplifiedInputs.push_back(Columns[Index].data());
+      }
+      Counterexample Cex;
+      for (size_t i = 0; i < Names.size(); i++) {
+        Cex.Assignment[Names[i]] = Columns[i][0];
+      }
+      OriginalKernel->Run(OriginalInputs.data(), &Cex.Original, 1);
+      SimplifiedKernel->Run(SimplifiedInputs.data(), &Cex.Simplified, 1);
+      Report.Mismatches++;
+      if (Report.Counterexamples.size() < Options.MaxCounterexamples) {
+        Report.Counterexamples.push_back(Cex);
+      }
+      Report.Equivalent = false;
+    } else {
+      cout << "CheckEquivalence: the solver couldn't decide the equivalence" << endl;
+    }
+  }
+  return Report;
+}
@@ -6,24 +6,47 @@
 #include <algorithm>
 #include <chrono>
 #include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <set>
 #include <map>
 
 // llvm
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Transforms/IPO/AlwaysInliner.h>
 #include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/Analysis/DemandedBits.h>
+#include <llvm/ExecutionEngine/MCJIT.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/KnownBits.h>
 #include <llvm/IR/PatternMatch.h>
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/Linker/Linker.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/ValueHandle.h>
 #include <llvm/IR/ValueMap.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Support/Host.h>
 
 // triton
 #include <triton/api.hpp>
 
+// translator
+#include <AstBuilder.hpp>
+#include <MBATable.hpp>
+
 // llvm namespaces
 using namespace std;
 using namespace llvm;
@@ -35,8 +58,73 @@ using namespace triton::ast;
 
 // typedefs
 using ExpKey = triton::usize;
+using SharedExpression = triton::engines::symbolic::SharedSymbolicExpression;
+using BatchFunction = void (*)(const uint64_t* const* Columns, uint64_t* Output, uint64_t Count);
+
+// Cache of the lifted references shared between threads
+class SharedReferenceCache;
 
 // strutures
+typedef struct TranslatorOptions {
+  // Lift the variables as arguments of TritonAstFunction (ordered by symbolic variable ID) instead of global variables
+  bool VariablesAsArguments = false;
+  // Reuse the released Module objects instead of allocating new ones
+  bool RecycleModules = false;
+  // Replace the linear MBA sub-expressions with their minimal equivalent before lifting
+  bool TruthTableLookup = false;
+  // Repeat the optimization pipeline while the instruction count drops (1 = single run)
+  uint32_t MaxOptimizationIterations = 1;
+  // Stop repeating the pipeline after this wall-clock time in milliseconds (0 = unlimited)
+  uint64_t OptimizationBudget = 0;
+  // Stop repeating the pipeline once the instruction count is not above this size
+  uint64_t OptimizationSizeFloor = 0;
+  // Lift the instructions with multiple uses back as references to new symbolic expressions
+  bool SharedValuesAsReferences = false;
+  // Lift the values back at the width of their unknown (and demanded) bits, the rest as constants
+  bool NarrowKnownBits = false;
+  // Lift back the 'extract', 'concat' and 'ite' idioms as such, instead of shifts and masks
+  bool RecoverIdioms = false;
+  // Lift back the instructions left untouched by the optimizations as their original nodes
+  bool ReuseOriginalNodes = false;
+  // Decide for each reference whether to inline it, keep it as a call or cut it as a fake variable
+  bool SizeAwareReferences = false;
+  // Always inline the references up to this many nodes
+  uint64_t InlineSizeFloor = 64;
+  // Nodes the larger references may copy in a translation by being inlined (once per use)
+  uint64_t InlineBudget = 4096;
+  // Keep as calls the larger references up to this many nodes, cutting the others
+  uint64_t MaxCallSize = 65536;
+} TranslatorOptions;
+
+// Way of lifting a reference
+enum class ReferenceAction {
+  Inline,
+  Call,
+  Opaque
+};
+
+// Outcome of a translation
+enum class TranslationStatus {
+  Success,
+  TimedOut,
+  NodeBudgetExceeded,
+  InstructionBudgetExceeded,
+  Unsupported,
+  Cancelled,
+  Failed
+};
+
+typedef struct TranslationLimits {
+  // Point in time after which the translation is aborted
+  chrono::steady_clock::time_point Deadline = chrono::steady_clock::time_point::max();
+  // Maximum number of AST nodes visited while lifting (0 = unlimited)
+  uint64_t MaxNodes = 0;
+  // Maximum number of instructions of the lifted function (0 = unlimited)
+  uint64_t MaxInstructions = 0;
+  // Flag aborting the translation once set, e.g. from another thread (optional)
+  const atomic<bool>* Cancelled = nullptr;
+} TranslationLimits;
+
 typedef struct AstNode {
   // Special values for the reference handling
   triton::engines::symbolic::SharedSymbolicExpression Expression;
@@ -49,6 +137,8 @@ typedef struct AstNode {
   // Normal values for the standard handling
   shared_ptr<AstNode> Parent;
   SharedAbstractNode Node;
+  // Equivalent expression lifted in place of the node
+  SharedAbstractNode Rewrite;
   uint64_t Index;
   // Depth of the AST
   size_t Depth;
@@ -77,6 +167,116 @@ typedef struct AstNode {
   }
 } AstNode;
 
+typedef struct LiftedValue {
+  // Original node of the instruction (nullptr for the helper instructions)
+  SharedAbstractNode Node;
+  // Instruction (null once deleted) and its shape before the optimizations
+  WeakVH Value;
+  unsigned Opcode = 0;
+  unsigned Predicate = 0;
+  vector<WeakVH> Operands;
+  // The instruction and its operands are unchanged (-1 = not checked yet)
+  int8_t Untouched = -1;
+} LiftedValue;
+
+typedef struct ReferenceUsage {
+  // Nodes of the referenced AST (the nested references count as one node)
+  uint64_t Size = 0;
+  // Number of uses of the reference
+  uint64_t Uses = 0;
+} ReferenceUsage;
+
+typedef struct MBAShape {
+  // The expression is a linear combination of bitwise expressions
+  bool Linear = false;
+  // The expression only uses bitwise operations
+  bool Bitwise = false;
+  // Variables of the expression (by name)
+  map<string, SharedAbstractNode> Variables;
+} MBAShape;
+
+typedef struct BatchKernel {
+  // Execution engine owning the compiled code
+  shared_ptr<ExecutionEngine> Engine;
+  // Entry point of the vectorized kernel
+  BatchFunction Function;
+  // Variable names, in the same order of the input columns
+  vector<string> Variables;
+  // Bitvector size of the evaluated expression
+  uint64_t BitvectorSize;
+  // Default constructor
+  BatchKernel() : Engine(nullptr), Function(nullptr), BitvectorSize(0) {}
+  // Evaluate 'Count' assignments (one column per variable)
+  void Run(const uint64_t* const* Columns, uint64_t* Output, uint64_t Count) const {
+    this->Function(Columns, Output, Count);
+  }
+} BatchKernel;
+
+typedef struct EquivalenceOptions {
+  // Number of random samples (the corner cases are extra)
+  uint64_t Samples = 1 << 20;
+  // Maximum number of corner case combinations
+  uint64_t CornerSamples = 1 << 16;
+  // Number of worker threads (0 means one per hardware thread)
+  size_t Threads = 0;
+  // Seed of the random generator
+  uint64_t Seed = 0x5EED;
+  // Stop after collecting this many counterexamples
+  size_t MaxCounterexamples = 8;
+  // Ask the solver for a proof when all the samples agree
+  bool Prove = false;
+} EquivalenceOptions;
+
+typedef struct Counterexample {
+  // Values of the variables
+  map<string, uint64_t> Assignment;
+  // Values of the compared expressions
+  uint64_t Original;
+  uint64_t Simplified;
+} Counterexample;
+
+typedef struct EquivalenceReport {
+  // Outcome of the check; when it isn't Success the other fields are meaningless
+  TranslationStatus Status = TranslationStatus::Success;
+  // Reason of the failure
+  string Error;
+  // No sample showed a difference
+  bool Equivalent = true;
+  // The solver answered UNSAT on the distinct query
+  bool Proved = false;
+  // Number of evaluated samples
+  uint64_t Samples = 0;
+  // Number of mismatching samples seen before stopping (independent of MaxCounterexamples)
+  uint64_t Mismatches = 0;
+  // Evaluation throughput
+  double SamplesPerSecond = 0;
+  // Assignments on which the expressions differ
+  vector<Counterexample> Counterexamples;
+  // Print the report
+  void dump() {
+    if (this->Status != TranslationStatus::Success) {
+      cout << "{ Error = " << this->Error << " }" << endl;
+      return;
+    }
+    cout << "{ Equivalent = " << (this->Equivalent ? "true" : "false")
+         << ", Proved = " << (this->Proved ? "true" : "false")
+         << ", Samples = " << dec << this->Samples
+         << ", SamplesPerSecond = " << fixed << this->SamplesPerSecond
+         << ", Mismatches = " << dec << this->Mismatches
+         << ", Counterexamples = " << dec << this->Counterexamples.size()
+         << " }" << endl;
+    for (auto& Cex : this->Counterexamples) {
+      cout << "  {";
+      for (auto& Var : Cex.Assignment) {
+        cout << " " << Var.first << " = 0x" << hex << Var.second << ";";
+      }
+      cout << " Original = 0x" << hex << Cex.Original
+           << ", Simplified = 0x" << hex << Cex.Simplified
+           << " }" << dec << endl;
+    }
+  }
+} EquivalenceReport;
+
 /*
   The idea is to use the "visitor pattern" to implement the lifting of a Triton
   AST to LLVM-IR to provide the capability to optimize it and get back to have a
@@ -93,22 +293,113 @@ private:
   // Fields needed for the Triton 2 LLVM conversion
   LLVMContext& Context;
   shared_ptr<Module> Module;
+  // Sub-trees cut at the maximum depth, or references kept opaque (by fake variable name, unique across the Translator(s))
+  map<string, SharedAbstractNode> FakeVars;
 
   // Fields needed for the LLVM 2 Triton conversion
   API& Api;
   map<string, SharedAbstractNode> Vars;
   map<string, Value*> VarsValue;
+  vector<SharedAbstractNode> ArgumentNodes;
+
+  // Concrete values of the variables substituted by the current lifting (by variable name)
+  map<string, triton::uint512> Assignment;
+
+  // Values of the expressions already lifted in the current trace (by expression ID)
+  map<ExpKey, Value*> TraceValues;
+
+  // Size and uses of the references of the current translation, and the way each one is lifted
+  map<ExpKey, ReferenceUsage> ReferenceUsages;
+  map<ExpKey, ReferenceAction> ReferenceActions;
+  uint64_t InlinedNodes = 0;
+
+  // Instructions of the last lifted function, before the optimizations
+  map<Value*, LiftedValue> Provenance;
+
+  // Analyses of the function lifted back, used to narrow the values
+  unique_ptr<AssumptionCache> Assumptions;
+  unique_ptr<DominatorTree> Dominators;
+  unique_ptr<DemandedBits> Demanded;
+
+  // Optional behaviours of the translation
+  TranslatorOptions Options;
+
+  // Cache of the references shared with the other Translator(s) (optional)
+  SharedReferenceCache* SharedCache = nullptr;
+
+  // Number of pipeline runs of the last optimization
+  uint32_t OptimizationIterations = 0;
+
+  // Limits of the current translation and its outcome
+  TranslationLimits Limits;
+  TranslationStatus Status = TranslationStatus::Success;
+  uint64_t VisitedNodes = 0;
+  uint64_t LiftedInstructions = 0;
+
+  // Check the limits of the current translation (false if one is reached)
+  bool CheckLimits(uint64_t Instructions = 0);
+
+  // Released Modules ready to be reused
+  shared_ptr<vector<unique_ptr<llvm::Module>>> ModulePool = make_shared<vector<unique_ptr<llvm::Module>>>();
+
+  // Allocate a new Module (possibly recycled)
+  shared_ptr<llvm::Module> AllocateModule(const string& Name);
 
   // Get a properly sized decimal node
   ConstantInt* GetDecimal(IntegerNode& Value, uint64_t BitVectorSize);
 
+  // Get the constant of an assigned variable (truncated to its size)
+  ConstantInt* GetAssignedValue(const triton::uint512& Value, uint32_t Size);
+
+  // Replace the loads of the assigned variables (even by the linked references) with their value
+  void SubstituteAssignment(llvm::Module* M);
+
+  // Measure the size and the uses of the references reachable from an AST
+  void MeasureReferences(const SharedAbstractNode& Root);
+
+  // Decide how to lift a reference, charging the inlined nodes to the budget
+  ReferenceAction DecideReference(ExpKey Id);
+
+  // Fetch a reference lifted by another thread, or claim it (false if claimed or unavailable)
+  bool FetchShared(ExpKey Id, map<ExpKey, shared_ptr<llvm::Module>>& Cache, set<ExpKey>& Claimed);
+
   // Lift the nodes in an AST in a worklist-based way
-  Value* LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IRBuilder<>> IR, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth);
+  Value* LiftNodesWBS(const SharedAbstractNode& TopNode, shared_ptr<IRBuilder<>> IR, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth, map<SharedAbstractNode, Value*>& Nodes);
+
+  // Get the fields of the structure returned by TritonAstFunction
+  bool CollectFields(Function* TritonAstFunction, vector<Value*>& Fields);
+
+  // Lift the body of TritonAstFunction to a Triton AST
+  SharedAbstractNode LiftTritonAstFunction(Function* TritonAstFunction, map<string, SharedAbstractNode>& Variables, bool IsITE, bool IsLogical);
+
+  // Print a value of TritonAstFunction as a SMT-LIB2 term (the shared values by their 'let' name)
+  bool EmitSMTLIB(Value* V, bool AsBoolean, ostream& Out, const map<Value*, string>& Bound, map<string, SharedAbstractNode>& Variables);
+
+  // Remember the original nodes and the shape of the instructions of a lifted function
+  void RecordProvenance(Function* F, const map<SharedAbstractNode, Value*>& Nodes);
+
+  // Check if an instruction and its operands are unchanged since they were lifted
+  bool IsUntouched(Value* V);
+
+  // Get the original node of a value left untouched by the optimizations (nullptr if changed)
+  SharedAbstractNode GetOriginalNode(Value* V);
+
+  // Run the analyses needed to narrow the values of a function (if requested)
+  void PrepareNarrowing(Function* F);
+
+  // Get the low bits of a node, looking through the nodes which already expose them
+  SharedAbstractNode LowBits(const SharedAbstractNode& Node, uint32 Width);
+
+  // Rebuild a lifted instruction at the width of its unknown bits, the rest as constants
+  SharedAbstractNode NarrowValue(llvm::Instruction* Inst, const SharedAbstractNode& Node);
+
+  // Recover the compact node of an idiom generated by the lifting (nullptr if unknown)
+  SharedAbstractNode RecoverIdiom(Value* value, map<Value*, SharedAbstractNode>& values, map<string, SharedAbstractNode>& variables);
 
   // Lift the instructions in a block in a DFS way
   SharedAbstractNode LiftInstructionsDFS(Value* value, map<Value*, SharedAbstractNode>& Values, map<string, SharedAbstractNode>& Variables);
 
-  // Optimize our LLVM Module
+  // Optimize our LLVM Module (up to a fixed-point if requested)
   void OptimizeModule(llvm::Module* M);
 
   // Lower thr BSWAP intrinsic
@@ -129,18 +420,123 @@ private:
   // Determine AST size
   uint64_t DetermineASTSize(SharedAbstractNode Node, map<SharedAbstractNode, uint64_t>& Nodes);
 
+  // Replace the loads of the variables with arguments of TritonAstFunction
+  Function* PromoteVariablesToArguments(llvm::Module* M);
+
+  // Optimize a batch kernel for the host target
+  void OptimizeKernel(llvm::Module* M, TargetMachine* TM);
+
+  // Classify an AST as a linear MBA expression
+  const MBAShape& ClassifyMBA(const SharedAbstractNode& Node, map<AbstractNode*, MBAShape>& Shapes);
+
+  // Evaluate a linear MBA expression on the boolean corners of its variables
+  const vector<uint64_t>& EvaluateMBA(const SharedAbstractNode& Node, const vector<string>& Names, map<AbstractNode*, vector<uint64_t>>& Values);
+
+  // Build the minimal expression of a bitwise function
+  SharedAbstractNode BuildBitwise(const MBATable& Table, uint16_t TruthTable, const vector<SharedAbstractNode>& Variables, map<uint16_t, SharedAbstractNode>& Built);
+
+  // Build the expression of a linear MBA signature
+  SharedAbstractNode BuildMBA(const vector<uint64_t>& Signature, uint32_t Size, const vector<SharedAbstractNode>& Variables);
+
+  // Look up the minimal equivalent expression of a linear MBA AST
+  SharedAbstractNode LookupMBA(const SharedAbstractNode& Node, map<AbstractNode*, MBAShape>& Shapes, map<SharedAbstractNode, uint64_t>& Sizes);
+
+  // Collect the variables of an AST (references included)
+  void CollectVariables(const SharedAbstractNode& Node, map<string, SharedAbstractNode>& Variables, set<AbstractNode*>& Visited);
+
 public:
   // Default constructor
-  Translator(LLVMContext& Context, API& Api);
+  Translator(LLVMContext& Context, API& Api, const TranslatorOptions& Options = TranslatorOptions());
 
   // Default destructor
   ~Translator() {};
 
+  // Get the translation options
+  const TranslatorOptions& GetOptions() const;
+
+  // Set the translation options
+  void SetOptions(const TranslatorOptions& Options);
+
+  // Get the number of pipeline runs of the last optimization
+  uint32_t GetOptimizationIterations() const;
+
+  // Share the lifted references with the Translator(s) of other threads (nullptr to stop)
+  void SetSharedCache(SharedReferenceCache* Cache);
+
+  // Set the limits checked by the following translations
+  void SetLimits(const TranslationLimits& Limits);
+
+  // Get the outcome of the last translation
+  TranslationStatus GetStatus() const;
+
+  // Get a printable name of a translation outcome
+  static const char* GetStatusName(TranslationStatus Status);
+
+  // Get the sub-trees cut at the maximum depth by the last translation
+  const map<string, SharedAbstractNode>& GetFakeVariables() const;
+
+  // Get the number of instructions lifted by the last translation (before the optimizations)
+  uint64_t GetLiftedInstructions() const;
+
+  // Register the node of a fake variable by Triton context and name, restored when a block loading it is linked (the caller keeps the node alive)
+  static void RegisterFakeVariable(const API& Api, const string& Name, const SharedAbstractNode& Node);
+
+  // Simplify a Triton AST within limits (Result is the original AST unless successful)
+  TranslationStatus Simplify(const SharedAbstractNode& Node, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, SharedAbstractNode& Result, const TranslationLimits& Limits, ssize_t MaxDepth = -1);
+
   // Lift a Triton AST to a LLVM-IR block
   shared_ptr<llvm::Module> TritonAstToLLVMIR(const SharedAbstractNode& Node, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth = -1);
 
+  // Lift a Triton AST to a LLVM-IR block, substituting the assigned variables with their value
+  shared_ptr<llvm::Module> TritonAstToLLVMIR(const SharedAbstractNode& Node, const map<string, triton::uint512>& Assignment, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth = -1);
+
+  // Simplify a Triton AST with respect to the variables missing from a partial assignment (nullptr on failure)
+  SharedAbstractNode PartiallyEvaluate(const SharedAbstractNode& Node, const map<string, triton::uint512>& Assignment, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, ssize_t MaxDepth = -1);
+
+  // Collect the expressions referenced (transitively) by some expressions, in ID order
+  vector<SharedExpression> CollectTrace(const vector<SharedExpression>& Expressions) const;
+
+  // Lift a trace of expressions (each one once, as a value of the same block) returning the requested ones
+  shared_ptr<llvm::Module> TritonTraceToLLVMIR(const vector<SharedExpression>& Trace, const vector<SharedExpression>& Requested, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth = -1);
+
+  // Simplify some expressions of a trace with a single optimization run (empty on failure, the original ASTs if they can't be lifted back)
+  vector<SharedAbstractNode> SimplifyTrace(const vector<SharedExpression>& Requested, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, ssize_t MaxDepth = -1);
+
+  // Lift multiple Triton ASTs (sharing their nodes) to a LLVM-IR block
+  shared_ptr<llvm::Module> TritonAstsToLLVMIR(const vector<SharedAbstractNode>& Roots, map<ExpKey, shared_ptr<llvm::Module>>& Cache, ssize_t MaxDepth = -1);
+
   // Lift a LLVM-IR block to a Triton AST
   SharedAbstractNode LLVMIRToTritonAst(const shared_ptr<llvm::Module>& Module, map<string, SharedAbstractNode>& Variables, bool IsITE = false, bool IsLogical = false);
+
+  // Lift a LLVM-IR block returning multiple values to Triton ASTs (sharing their nodes)
+  vector<SharedAbstractNode> LLVMIRToTritonAsts(const shared_ptr<llvm::Module>& Module, map<string, SharedAbstractNode>& Variables, bool IsITE = false, bool IsLogical = false);
+
+  // Print a LLVM-IR block as a SMT-LIB2 term, sharing the multi-use values with 'let' (empty on error)
+  string LLVMIRToSMTLIB(const shared_ptr<llvm::Module>& Module, map<string, SharedAbstractNode>& Variables, bool IsLogical = false);
+
+  // Simplify a Triton AST within limits, printing it as a SMT-LIB2 term without rebuilding a Triton AST
+  TranslationStatus SimplifyToSMTLIB(const SharedAbstractNode& Node, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, string& Result, const TranslationLimits& Limits, ssize_t MaxDepth = -1);
+
+  // Simplify the predicates of a path constraint together, dropping the redundant ones
+  vector<SharedAbstractNode> SimplifyPathConstraints(const vector<SharedAbstractNode>& Predicates, map<ExpKey, shared_ptr<llvm::Module>>& Cache, map<string, SharedAbstractNode>& Variables, ssize_t MaxDepth = -1);
+
+  // Lift a LLVM-IR block to a Triton AST (variables given in the order of the arguments)
+  SharedAbstractNode LLVMIRToTritonAst(const shared_ptr<llvm::Module>& Module, const vector<SharedAbstractNode>& Arguments, bool IsITE = false, bool IsLogical = false);
+
+  // Get the names of the variables lifted as arguments
+  vector<string> GetVariableArguments(const shared_ptr<llvm::Module>& Module) const;
+
+  // Get the minimal equivalent expression of a known MBA shape (nullptr if unknown)
+  SharedAbstractNode SimplifyKnownMBA(const SharedAbstractNode& Node);
+
+  // Compile a Triton AST to a vectorized kernel evaluating many assignments per call
+  shared_ptr<BatchKernel> CompileBatchKernel(const SharedAbstractNode& Node, map<ExpKey, shared_ptr<llvm::Module>>& Cache);
+
+  // Evaluate a Triton AST over columns of variable assignments (Rows counts the rows of an AST without variables)
+  vector<uint64_t> EvaluateBatch(const SharedAbstractNode& Node, const map<string, vector<uint64_t>>& Columns, map<ExpKey, shared_ptr<llvm::Module>>& Cache, uint64_t Rows = 0);
+
+  // Check the equivalence of two ASTs on random and corner case inputs
+  EquivalenceReport CheckEquivalence(const SharedAbstractNode& Original, const SharedAbstractNode& Simplified, map<ExpKey, shared_ptr<llvm::Module>>& Cache, const EquivalenceOptions& Options = EquivalenceOptions());
   
 };
 